@@ -2,17 +2,37 @@
 
 #include "GLMemoryHelpers.h"
 #include "GLColor.h"
+#include "GLStateCache.h"
 #include "GLShader.h"
+#include "GLShaderBinaryCache.h"
+#include "GLShaderRegistry.h"
+#include "GLUniformBuffer.h"
+#include "GLTextureBuffer.h"
+#include "GLInstanceBuffer.h"
+#include "GLGeometryPool.h"
+#include "GLDrawCommandBuffer.h"
+#include "GLJobSystem.h"
 #include "GLMesh.h"
 #include "GLMeshLoader.h"
 #include "GLTexture.h"
 #include "GLTextureLoader.h"
+#include "GLTextureArray.h"
+#include "GLSampler.h"
 #include "GLPrimitiveMeshes.h"
 #include "GLPrimitiveObjects.h"
 #include "GLMaterial.h"
 #include "GLMeshRenderer.h"
+#include "GLFrustum.h"
+#include "GLRenderCommandBuffer.h"
+#include "GLRenderQueue.h"
 #include "GLLight.h"
+#include "GLLightBuffer.h"
+#include "GLLightClusters.h"
+#include "GLGBuffer.h"
+#include "GLDeferredRenderer.h"
+#include "GLDepthPrePass.h"
 #include "GLGameObject.h"
+#include "GLStaticBatcher.h"
 #include "GLPhysics.h"
 #include "GLRigidBody.h"
 #include "GLScene.h"
@@ -1,159 +1,181 @@
 #pragma once
 
+#include <string>
+
 #include "GLShader.h"
+#include "GLShaderRegistry.h"
+
+// Built-in programs. Every material using the same built-in shader and defines shares one program.
 
-class GLBasicShader : public GLShader
+class GLBasicShader
 {
-private:
-	static GLShaderLoader vertexShaderSource;
-	static GLShaderLoader fragmentShaderSource;
-	static bool initialized;
 public:
-    GLBasicShader()
+	static GLSharedPtr<GLShader> Get(const GLShaderDefines& defines = GLShaderDefines())
 	{
-		if (!initialized)
-		{
-			initialized = true;
-
-			vertexShaderSource = GLShaderLoader("shaders\\BasicVertexShader.glsl");
-			fragmentShaderSource = GLShaderLoader("shaders\\BasicFragmentShader.glsl");
-		}
-
-		GLVertexShaderLoader vertexShader;
-		GLFragmentShaderLoader fragmentShader;
-
-		vertexShader.SetSource(vertexShaderSource.GetSource());
-		fragmentShader.SetSource(fragmentShaderSource.GetSource());
-
-		vertexShader.Load();
-		fragmentShader.Load();
-
-		this->CreateProgram(vertexShader, fragmentShader);
+		return GLShaderRegistry::Load("shaders\\BasicVertexShader.glsl", "shaders\\BasicFragmentShader.glsl", defines);
 	}
+};
 
-	virtual ~GLBasicShader()
+class GLBasicTextureShader
+{
+public:
+	static GLSharedPtr<GLShader> Get(const GLShaderDefines& defines = GLShaderDefines())
 	{
-
+		return GLShaderRegistry::Load("shaders\\BasicTextureVertexShader.glsl", "shaders\\BasicTextureFragmentShader.glsl", defines);
 	}
 };
 
-GLShaderLoader GLBasicShader::vertexShaderSource;
-GLShaderLoader GLBasicShader::fragmentShaderSource;
-bool GLBasicShader::initialized = false;
-
-class GLBasicMaterialShader : public GLShader
+// Position only program of the depth pre-pass.
+class GLDepthShader
 {
-private:
-	static GLShaderLoader vertexShaderSource;
-	static GLShaderLoader fragmentShaderSource;
-	static bool initialized;
 public:
-	GLBasicMaterialShader()
+	static GLSharedPtr<GLShader> Get(const GLShaderDefines& defines = GLShaderDefines())
 	{
-		if (!initialized)
-		{
-			initialized = true;
+		return GLShaderRegistry::Load("shaders\\DepthVertexShader.glsl", "shaders\\DepthFragmentShader.glsl", defines);
+	}
+};
 
-			vertexShaderSource = GLShaderLoader("shaders\\BasicMaterialVertexShader.glsl");
-			fragmentShaderSource = GLShaderLoader("shaders\\BasicMaterialFragmentShader.glsl");
-		}
+// Instanced variants read the model matrix from GLInstanceBuffer instead of the model uniform.
+inline GLShaderDefines GLGetInstancedDefines(GLShaderDefines defines = GLShaderDefines())
+{
+	defines["INSTANCED"] = "1";
 
-		GLVertexShaderLoader vertexShader;
-		GLFragmentShaderLoader fragmentShader;
+	return defines;
+}
 
-		vertexShader.SetSource(vertexShaderSource.GetSource());
-		fragmentShader.SetSource(fragmentShaderSource.GetSource());
+// Multi-draw variants read the instance values per draw from the Draws storage block, see DrawData.glsl.
+inline GLShaderDefines GLGetMultiDrawDefines(GLShaderDefines defines = GLShaderDefines())
+{
+	defines["MULTI_DRAW"] = "1";
 
-		vertexShader.Load();
-		fragmentShader.Load();
+	return GLGetInstancedDefines(defines);
+}
 
-		this->CreateProgram(vertexShader, fragmentShader);
-	}
+enum class GLDiffuseSource
+{
+	Color,
+	Map,
+	MapArray
+};
+
+// Lit material program. Each combination of diffuse source and light counts is its own
+// variant with fixed size light arrays, compiled the first time it is requested.
+class GLMaterialShader
+{
+public:
+	static const int MAX_LIGHT_COUNT = 16;
 
-	virtual ~GLBasicMaterialShader()
+	// Fixed light count, light list, clustered and G-buffer variants fall back to the uniform count variant of the same
+	// diffuse source while they compile, which shades with all lights. That one falls back to the
+	// unlit basic shader.
+	static GLSharedPtr<GLShader> Get(const GLShaderDefines& defines = GLShaderDefines())
 	{
+		GLSharedPtr<GLShader> fallback = nullptr;
 
-	}
-};
+		if (defines.find("DIRECTIONAL_LIGHT_COUNT") != defines.end() || defines.find("LIGHT_LIST_SIZE") != defines.end() ||
+			defines.find("CLUSTERED_LIGHTING") != defines.end() || defines.find("GBUFFER") != defines.end())
+		{
+			GLShaderDefines fallbackDefines = defines;
+			fallbackDefines.erase("DIRECTIONAL_LIGHT_COUNT");
+			fallbackDefines.erase("POINT_LIGHT_COUNT");
+			fallbackDefines.erase("SPOT_LIGHT_COUNT");
+			fallbackDefines.erase("LIGHT_LIST_SIZE");
+			fallbackDefines.erase("CLUSTERED_LIGHTING");
+			fallbackDefines.erase("GBUFFER");
+
+			fallback = Get(fallbackDefines);
+		}
+		else if (defines.find("MULTI_DRAW") != defines.end())
+		{
+			fallback = GLBasicShader::Get(GLGetMultiDrawDefines());
+		}
+		else if (defines.find("INSTANCED") != defines.end())
+		{
+			fallback = GLBasicShader::Get(GLGetInstancedDefines());
+		}
+		else
+		{
+			fallback = GLBasicShader::Get();
+		}
 
-GLShaderLoader GLBasicMaterialShader::vertexShaderSource;
-GLShaderLoader GLBasicMaterialShader::fragmentShaderSource;
-bool GLBasicMaterialShader::initialized = false;
+		return GLShaderRegistry::Load("shaders\\MaterialVertexShader.glsl", "shaders\\MaterialFragmentShader.glsl", defines, fallback);
+	}
 
-class GLBasicTextureShader : public GLShader
-{
-private:
-	static GLShaderLoader vertexShaderSource;
-	static GLShaderLoader fragmentShaderSource;
-	static bool initialized;
-public:
-	GLBasicTextureShader()
+	// Light counts below zero select the variant looping over uniform light counts.
+	static GLShaderDefines GetDefines(GLDiffuseSource diffuseSource, int directionalCount = -1, int pointCount = -1, int spotCount = -1)
 	{
-		if (!initialized)
+		GLShaderDefines defines;
+
+		if (diffuseSource == GLDiffuseSource::Map)
+		{
+			defines["HAS_DIFFUSE_MAP"] = "1";
+		}
+		else if (diffuseSource == GLDiffuseSource::MapArray)
 		{
-			initialized = true;
+			defines["HAS_DIFFUSE_MAP_ARRAY"] = "1";
+		}
 
-			vertexShaderSource = GLShaderLoader("shaders\\BasicTextureVertexShader.glsl");
-			fragmentShaderSource = GLShaderLoader("shaders\\BasicTextureFragmentShader.glsl");
+		if (directionalCount >= 0 && pointCount >= 0 && spotCount >= 0)
+		{
+			defines["DIRECTIONAL_LIGHT_COUNT"] = std::to_string(directionalCount);
+			defines["POINT_LIGHT_COUNT"] = std::to_string(pointCount);
+			defines["SPOT_LIGHT_COUNT"] = std::to_string(spotCount);
 		}
 
-		GLVertexShaderLoader vertexShader;
-		GLFragmentShaderLoader fragmentShader;
+		return defines;
+	}
+
+	// Variant shading every directional light and up to listSize point and spot lights chosen per object.
+	static GLShaderDefines GetLightListDefines(GLDiffuseSource diffuseSource, int listSize)
+	{
+		GLShaderDefines defines = GetDefines(diffuseSource);
+		defines["LIGHT_LIST_SIZE"] = std::to_string(listSize);
 
-		vertexShader.SetSource(vertexShaderSource.GetSource());
-		fragmentShader.SetSource(fragmentShaderSource.GetSource());
+		return defines;
+	}
 
-		vertexShader.Load();
-		fragmentShader.Load();
+	// Variant shading every directional light and the point and spot lights of the fragment's cluster.
+	static GLShaderDefines GetClusteredDefines(GLDiffuseSource diffuseSource)
+	{
+		GLShaderDefines defines = GetDefines(diffuseSource);
+		defines["CLUSTERED_LIGHTING"] = "1";
 
-		this->CreateProgram(vertexShader, fragmentShader);
+		return defines;
 	}
 
-	virtual ~GLBasicTextureShader()
+	// Unlit variant writing the surface into the G-buffer for deferred shading.
+	static GLShaderDefines GetGBufferDefines(GLDiffuseSource diffuseSource)
 	{
+		GLShaderDefines defines = GetDefines(diffuseSource);
+		defines["GBUFFER"] = "1";
 
+		return defines;
 	}
 };
 
-GLShaderLoader GLBasicTextureShader::vertexShaderSource;
-GLShaderLoader GLBasicTextureShader::fragmentShaderSource;
-bool GLBasicTextureShader::initialized = false;
-
-class GLBasicTextureMaterialShader : public GLShader
+class GLBasicMaterialShader
 {
-private:
-	static GLShaderLoader vertexShaderSource;
-	static GLShaderLoader fragmentShaderSource;
-	static bool initialized;
 public:
-	GLBasicTextureMaterialShader()
+	static GLSharedPtr<GLShader> Get()
 	{
-		if (!initialized)
-		{
-			initialized = true;
-
-			vertexShaderSource = GLShaderLoader("shaders\\BasicTextureMaterialVertexShader.glsl");
-			fragmentShaderSource = GLShaderLoader("shaders\\BasicTextureMaterialFragmentShader.glsl");
-		}
-
-		GLVertexShaderLoader vertexShader;
-		GLFragmentShaderLoader fragmentShader;
-
-		vertexShader.SetSource(vertexShaderSource.GetSource());
-		fragmentShader.SetSource(fragmentShaderSource.GetSource());
-
-		vertexShader.Load();
-		fragmentShader.Load();
-
-		this->CreateProgram(vertexShader, fragmentShader);
+		return GLMaterialShader::Get(GLMaterialShader::GetDefines(GLDiffuseSource::Color));
 	}
+};
 
-	virtual ~GLBasicTextureMaterialShader()
+class GLBasicTextureMaterialShader
+{
+public:
+	static GLSharedPtr<GLShader> Get()
 	{
-
+		return GLMaterialShader::Get(GLMaterialShader::GetDefines(GLDiffuseSource::Map));
 	}
 };
 
-GLShaderLoader GLBasicTextureMaterialShader::vertexShaderSource;
-GLShaderLoader GLBasicTextureMaterialShader::fragmentShaderSource;
-bool GLBasicTextureMaterialShader::initialized = false;
\ No newline at end of file
+class GLBasicTextureArrayMaterialShader
+{
+public:
+	static GLSharedPtr<GLShader> Get()
+	{
+		return GLMaterialShader::Get(GLMaterialShader::GetDefines(GLDiffuseSource::MapArray));
+	}
+};
\ No newline at end of file
@@ -8,12 +8,42 @@
 #include "GLMemoryHelpers.h"
 #include "GLTransform.h"
 #include "GLGameObject.h"
+#include "GLRenderQueue.h"
+#include "GLFrustum.h"
+#include "GLUniformBuffer.h"
+#include "GLLightBuffer.h"
+#include "GLLightClusters.h"
+#include "GLDeferredRenderer.h"
+#include "GLDepthPrePass.h"
 
 #undef near
 #undef far
 
 class GLScene;
 
+// std140 layout of the Camera block in shaders/Camera.glsl.
+struct GLCameraUniforms
+{
+	glm::mat4 View;
+	glm::mat4 Projection;
+	glm::mat4 ViewProjection;
+	glm::vec4 Position;
+	glm::vec4 Viewport;
+
+	// Depth slice scale and bias of the light clusters, see GLLightClusters.
+	glm::vec4 ClusterParams;
+	glm::tvec4<int> ClusterGrid;
+
+	// For reconstructing positions from depth.
+	glm::mat4 InverseViewProjection;
+};
+
+enum class GLRenderPath
+{
+	Forward,
+	Deferred
+};
+
 class GCamera : public GLGameObject
 {
 public:
@@ -108,10 +138,148 @@ public:
 		return this->projectionMatrix;
 	}
 
+	// World space planes of the cached matrices.
+	const GLFrustum& GetFrustum()
+	{
+		return this->frustum;
+	}
+
 	void UpdateMatrices()
 	{
 		this->UpdateViewMatrix();
     	this->UpdateProjectionMatrix();
+
+		this->frustum.Update(this->projectionMatrix * this->viewMatrix);
+	}
+
+	bool IsFrustumCulling()
+	{
+		return this->bFrustumCulling;
+	}
+
+	// Leaves out objects whose bounding spheres are outside the view frustum. Turn it off when
+	// custom shaders move vertices beyond the bounds of their meshes.
+	void SetFrustumCulling(bool bFrustumCulling)
+	{
+		this->bFrustumCulling = bFrustumCulling;
+	}
+
+	bool IsClusteredLighting()
+	{
+		return this->bClusteredLighting;
+	}
+
+	// Shades with every point and spot light reaching each froxel of the view frustum instead of
+	// at most MAX_LIGHT_COUNT of each type, for scenes with many lights.
+	void SetClusteredLighting(bool bClusteredLighting)
+	{
+		this->bClusteredLighting = bClusteredLighting;
+	}
+
+	// Assigns the lights to the clusters of the cached matrices and binds the light data, once per
+	// camera and frame before BindUniforms.
+	void UpdateLightClusters(GLLightBuffer& lights)
+	{
+		if (this->lightClusters == nullptr)
+		{
+			this->lightClusters = GLCreate<GLLightClusters>();
+		}
+
+		lights.BindLightData();
+
+		this->lightClusters->Update(this->viewMatrix, this->projectionMatrix, lights);
+		this->lightClusters->Bind();
+	}
+
+	const GLSharedPtr<GLLightClusters>& GetLightClusters()
+	{
+		return this->lightClusters;
+	}
+
+	GLRenderPath GetRenderPath()
+	{
+		return this->renderPath;
+	}
+
+	// Deferred shading lights opaque objects per covered pixel and light, blended objects and
+	// objects with custom shaders are still forward rendered.
+	void SetRenderPath(GLRenderPath renderPath)
+	{
+		this->renderPath = renderPath;
+	}
+
+	const GLSharedPtr<GLDeferredRenderer>& GetDeferredRenderer()
+	{
+		if (this->deferredRenderer == nullptr)
+		{
+			this->deferredRenderer = GLCreate<GLDeferredRenderer>();
+		}
+
+		return this->deferredRenderer;
+	}
+
+	bool IsDepthPrePass()
+	{
+		return this->bDepthPrePass;
+	}
+
+	// Lays down the depth of opaque objects before shading them, so overlapping objects are shaded
+	// once per pixel. Worth it when the material shaders are expensive, used by forward cameras only.
+	void SetDepthPrePass(bool bDepthPrePass)
+	{
+		this->bDepthPrePass = bDepthPrePass;
+	}
+
+	const GLSharedPtr<GLDepthPrePass>& GetDepthPrePass()
+	{
+		if (this->depthPrePass == nullptr)
+		{
+			this->depthPrePass = GLCreate<GLDepthPrePass>();
+		}
+
+		return this->depthPrePass;
+	}
+
+	const GLSharedPtr<GLRenderQueue>& GetRenderQueue()
+	{
+		if (this->renderQueue == nullptr)
+		{
+			this->renderQueue = GLCreate<GLRenderQueue>();
+		}
+
+		return this->renderQueue;
+	}
+
+	// Writes the cached matrices into the camera uniform block and binds it, once per camera and frame.
+	// The viewport is in pixels.
+	void BindUniforms(const glm::vec4& viewport)
+	{
+		if (this->uniformBuffer == nullptr)
+		{
+			this->uniformBuffer = GLCreate<GLUniformBuffer>(sizeof(GLCameraUniforms));
+		}
+
+		GLCameraUniforms uniforms;
+		uniforms.View = this->viewMatrix;
+		uniforms.Projection = this->projectionMatrix;
+		uniforms.ViewProjection = this->projectionMatrix * this->viewMatrix;
+		uniforms.Position = glm::vec4(this->GetTransform()->GetPosition(), 1.0f);
+		uniforms.Viewport = viewport;
+		uniforms.InverseViewProjection = glm::inverse(uniforms.ViewProjection);
+
+		if (this->bClusteredLighting && this->lightClusters != nullptr)
+		{
+			uniforms.ClusterParams = this->lightClusters->GetParams();
+			uniforms.ClusterGrid = this->lightClusters->GetGrid();
+		}
+		else
+		{
+			uniforms.ClusterParams = glm::vec4(0.0f);
+			uniforms.ClusterGrid = glm::tvec4<int>(0);
+		}
+
+		this->uniformBuffer->Update(uniforms);
+		this->uniformBuffer->Bind(GLUniformBlockBinding::Camera);
 	}
 
 protected:
@@ -120,9 +288,21 @@ protected:
 
 	int order = 0;
 	bool bIsActive = false;
+	bool bClusteredLighting = false;
+	bool bDepthPrePass = false;
+	bool bFrustumCulling = true;
+
+	GLRenderPath renderPath = GLRenderPath::Forward;
 
 	glm::mat4 viewMatrix;
 	glm::mat4 projectionMatrix;
+	GLFrustum frustum;
+
+	GLSharedPtr<GLUniformBuffer> uniformBuffer = nullptr;
+	GLSharedPtr<GLLightClusters> lightClusters = nullptr;
+	GLSharedPtr<GLDeferredRenderer> deferredRenderer = nullptr;
+	GLSharedPtr<GLDepthPrePass> depthPrePass = nullptr;
+	GLSharedPtr<GLRenderQueue> renderQueue = nullptr;
 };
 
 class GOrthographicCamera : public GCamera
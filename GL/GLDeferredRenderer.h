@@ -0,0 +1,149 @@
+#pragma once
+
+#include <gl/glew.h>
+#include <gl/glm/glm.hpp>
+
+#include "GLMemoryHelpers.h"
+#include "GLShader.h"
+#include "GLShaderRegistry.h"
+#include "GLPrimitiveMeshes.h"
+#include "GLLightBuffer.h"
+#include "GLGBuffer.h"
+#include "GLStateCache.h"
+
+// Deferred shading for one camera. Opaque objects are drawn into the G-buffer without lighting,
+// then directional lights are applied in one full screen pass and every point and spot light
+// only on the pixels inside its range, drawn as an instanced sphere with additive blending.
+class GLDeferredRenderer
+{
+public:
+	static const unsigned int VOLUME_SEGMENTS = 16;
+	static const unsigned int VOLUME_RINGS = 8;
+
+	GLDeferredRenderer()
+	{
+		this->gBuffer = GLCreate<GLGBuffer>();
+		this->volumeMesh = GLCreate<GLUVSphereMesh>(VOLUME_SEGMENTS, VOLUME_RINGS);
+
+		// The full screen triangle is generated from gl_VertexID, but core profiles draw with a bound vertex array.
+		glGenVertexArrays(1, &this->emptyVertexArrayId);
+	}
+
+	virtual ~GLDeferredRenderer()
+	{
+		glDeleteVertexArrays(1, &this->emptyVertexArrayId);
+		GLStateCache::ForgetVertexArray(this->emptyVertexArrayId);
+	}
+
+	// Starts the geometry pass into a G-buffer the size of the window. The depth test is enabled
+	// for the pass so hidden surfaces never reach the lighting.
+	void BeginGeometry(const glm::vec2& windowSize)
+	{
+		this->gBuffer->Resize((int)windowSize.x, (int)windowSize.y);
+		this->gBuffer->Bind();
+
+		this->bDepthTest = GLStateCache::IsEnabled(GL_DEPTH_TEST);
+
+		GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+		GLStateCache::SetDepthFunc(GL_LESS);
+	}
+
+	void EndGeometry()
+	{
+		this->gBuffer->Unbind();
+	}
+
+	// Lights the G-buffer into the bound framebuffer and writes its depth, so forward rendered
+	// objects drawn afterwards are hidden behind deferred ones.
+	void RenderLights(GLLightBuffer& lights)
+	{
+		this->gBuffer->BindTextures();
+		lights.BindLightData();
+
+		GLStateCache::SetDepthFunc(GL_ALWAYS);
+
+		this->RenderPass(this->GetShader("DIRECTIONAL_LIGHTS"), 0);
+
+		// Volumes are drawn inside out, so each covered pixel is shaded once even with the camera inside.
+		GLStateCache::SetEnabled(GL_DEPTH_TEST, false);
+		GLStateCache::SetEnabled(GL_BLEND, true);
+		GLStateCache::SetBlendFunc(GL_ONE, GL_ONE);
+		GLStateCache::SetEnabled(GL_CULL_FACE, true);
+		GLStateCache::SetCullFace(GL_FRONT);
+
+		this->RenderPass(this->GetShader("POINT_LIGHT_VOLUME"), lights.GetTotalPointCount());
+		this->RenderPass(this->GetShader("SPOT_LIGHT_VOLUME"), lights.GetTotalSpotCount());
+
+		GLStateCache::SetCullFace(GL_BACK);
+		GLStateCache::SetEnabled(GL_CULL_FACE, false);
+		GLStateCache::SetEnabled(GL_BLEND, false);
+
+		GLStateCache::SetDepthFunc(GL_LESS);
+		GLStateCache::SetEnabled(GL_DEPTH_TEST, this->bDepthTest);
+	}
+
+	const GLSharedPtr<GLGBuffer>& GetGBuffer()
+	{
+		return this->gBuffer;
+	}
+
+private:
+	GLSharedPtr<GLShader> GetShader(const std::string& pass)
+	{
+		GLShaderDefines defines;
+		defines[pass] = "1";
+
+		return GLShaderRegistry::Load("shaders\\DeferredLightVertexShader.glsl", "shaders\\DeferredLightFragmentShader.glsl", defines);
+	}
+
+	// Draws the full screen triangle, or the volume mesh once per light.
+	void RenderPass(const GLSharedPtr<GLShader>& shader, int lightCount)
+	{
+		shader->Use();
+
+		shader->SetUniform(gAlbedoUniform, (int)GLTextureUnit::GBufferAlbedo);
+		shader->SetUniform(gNormalUniform, (int)GLTextureUnit::GBufferNormal);
+		shader->SetUniform(gSpecularUniform, (int)GLTextureUnit::GBufferSpecular);
+		shader->SetUniform(gDepthUniform, (int)GLTextureUnit::GBufferDepth);
+
+		if (lightCount <= 0)
+		{
+			GLStateCache::BindVertexArray(this->emptyVertexArrayId);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+
+			return;
+		}
+
+		// The mesh has radius 0.5 with its faces inside the sphere.
+		float volumeScale = 2.0f / (glm::cos(glm::pi<float>() / VOLUME_SEGMENTS) * glm::cos(glm::pi<float>() / VOLUME_RINGS));
+
+		shader->SetUniform(lightDataUniform, (int)GLTextureUnit::LightData);
+		shader->SetUniform(influenceThresholdUniform, GLLightBuffer::GetInfluenceThreshold());
+		shader->SetUniform(volumeScaleUniform, volumeScale);
+
+		this->volumeMesh->RenderInstanced(lightCount);
+	}
+
+	GLSharedPtr<GLGBuffer> gBuffer = nullptr;
+	GLSharedPtr<GLMesh> volumeMesh = nullptr;
+
+	GLuint emptyVertexArrayId = 0;
+
+	bool bDepthTest = false;
+
+	static const GLUniformHandle<int> gAlbedoUniform;
+	static const GLUniformHandle<int> gNormalUniform;
+	static const GLUniformHandle<int> gSpecularUniform;
+	static const GLUniformHandle<int> gDepthUniform;
+	static const GLUniformHandle<int> lightDataUniform;
+	static const GLUniformHandle<float> influenceThresholdUniform;
+	static const GLUniformHandle<float> volumeScaleUniform;
+};
+
+const GLUniformHandle<int> GLDeferredRenderer::gAlbedoUniform(GLHashName("gAlbedo"));
+const GLUniformHandle<int> GLDeferredRenderer::gNormalUniform(GLHashName("gNormal"));
+const GLUniformHandle<int> GLDeferredRenderer::gSpecularUniform(GLHashName("gSpecular"));
+const GLUniformHandle<int> GLDeferredRenderer::gDepthUniform(GLHashName("gDepth"));
+const GLUniformHandle<int> GLDeferredRenderer::lightDataUniform(GLHashName("lightData"));
+const GLUniformHandle<float> GLDeferredRenderer::influenceThresholdUniform(GLHashName("influenceThreshold"));
+const GLUniformHandle<float> GLDeferredRenderer::volumeScaleUniform(GLHashName("volumeScale"));
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <gl/glew.h>
+
+#include "GLMemoryHelpers.h"
+#include "GLStateCache.h"
+
+// Fragment counts of the depth pre-pass, read back one frame late so the queries never stall.
+struct GLDepthPrePassStats
+{
+	size_t Frames = 0;
+
+	// Fragments of opaque objects passing GL_LESS in draw order, what a depth tested forward pass shades.
+	GLuint64 DepthFragments = 0;
+
+	// Fragments shaded by the color pass, only the visible ones.
+	GLuint64 ShadedFragments = 0;
+
+	GLuint64 GetSavedFragments() const
+	{
+		return DepthFragments > ShadedFragments ? DepthFragments - ShadedFragments : 0;
+	}
+};
+
+// Depth pre-pass for one forward camera. Opaque objects are drawn first with a position only
+// shader and color writes masked, then shaded with GL_EQUAL depth testing, so every visible pixel
+// runs the material shader once however much the objects overlap. Blended objects and custom
+// shaders are drawn after with the usual GL_LESS.
+class GLDepthPrePass
+{
+public:
+	GLDepthPrePass()
+	{
+		glGenQueries(QUERY_COUNT, this->queryIds);
+	}
+
+	virtual ~GLDepthPrePass()
+	{
+		glDeleteQueries(QUERY_COUNT, this->queryIds);
+	}
+
+	void BeginDepth()
+	{
+		this->ReadQueries();
+
+		this->bDepthTest = GLStateCache::IsEnabled(GL_DEPTH_TEST);
+
+		GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+		GLStateCache::SetDepthFunc(GL_LESS);
+		GLStateCache::SetDepthMask(true);
+		GLStateCache::SetColorMask(false);
+
+		glBeginQuery(GL_SAMPLES_PASSED, this->queryIds[0]);
+	}
+
+	// The depth buffer is complete, shade only the fragments that ended up in it.
+	void BeginColor()
+	{
+		glEndQuery(GL_SAMPLES_PASSED);
+
+		GLStateCache::SetColorMask(true);
+		GLStateCache::SetDepthFunc(GL_EQUAL);
+		GLStateCache::SetDepthMask(false);
+
+		glBeginQuery(GL_SAMPLES_PASSED, this->queryIds[1]);
+	}
+
+	// Objects left out of the pre-pass are depth tested against it as usual.
+	void EndColor()
+	{
+		glEndQuery(GL_SAMPLES_PASSED);
+
+		GLStateCache::SetDepthFunc(GL_LESS);
+		GLStateCache::SetDepthMask(true);
+
+		this->bPending = true;
+	}
+
+	void End()
+	{
+		GLStateCache::SetEnabled(GL_DEPTH_TEST, this->bDepthTest);
+	}
+
+	const GLDepthPrePassStats& GetStats()
+	{
+		return this->stats;
+	}
+
+	void ResetStats()
+	{
+		this->stats = GLDepthPrePassStats();
+	}
+
+private:
+	static const int QUERY_COUNT = 2;
+
+	void ReadQueries()
+	{
+		if (!this->bPending)
+		{
+			return;
+		}
+
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(this->queryIds[1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		// Still in flight, this frame's counts are skipped rather than waited for.
+		if (available == GL_FALSE)
+		{
+			return;
+		}
+
+		GLuint64 depthFragments = 0;
+		GLuint64 shadedFragments = 0;
+
+		glGetQueryObjectui64v(this->queryIds[0], GL_QUERY_RESULT, &depthFragments);
+		glGetQueryObjectui64v(this->queryIds[1], GL_QUERY_RESULT, &shadedFragments);
+
+		this->stats.Frames++;
+		this->stats.DepthFragments += depthFragments;
+		this->stats.ShadedFragments += shadedFragments;
+
+		this->bPending = false;
+	}
+
+	GLuint queryIds[QUERY_COUNT] = { 0, 0 };
+	bool bPending = false;
+
+	bool bDepthTest = false;
+
+	GLDepthPrePassStats stats;
+};
\ No newline at end of file
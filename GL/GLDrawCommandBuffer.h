@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+
+#include <gl/glew.h>
+
+#include "GLStateCache.h"
+
+// Arguments of one draw of glMultiDrawArraysIndirect, laid out as GL reads them.
+struct GLDrawArraysCommand
+{
+	GLuint Count = 0;
+	GLuint InstanceCount = 1;
+	GLuint First = 0;
+
+	// Draws find their data by draw id instead, and without base instance support GL requires 0.
+	GLuint BaseInstance = 0;
+};
+
+// Draw commands in a GL_DRAW_INDIRECT_BUFFER, submitted in ranges with one multi-draw call each.
+class GLDrawCommandBuffer
+{
+public:
+	GLDrawCommandBuffer()
+	{
+		glGenBuffers(1, &this->bufferId);
+	}
+
+	virtual ~GLDrawCommandBuffer()
+	{
+		glDeleteBuffers(1, &this->bufferId);
+		GLStateCache::ForgetBuffer(this->bufferId);
+	}
+
+	// Multi-draw indirect, gl_DrawIDARB to tell the draws apart and storage buffers for their data.
+	static bool IsSupported()
+	{
+		return GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_draw_parameters && GLEW_ARB_shader_storage_buffer_object;
+	}
+
+	// Replaces the contents, orphaning the storage like GLInstanceBuffer.
+	void Update(const std::vector<GLDrawArraysCommand>& commands)
+	{
+		GLsizeiptr size = commands.size() * sizeof(GLDrawArraysCommand);
+
+		GLStateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, this->bufferId);
+
+		if (size > this->capacity)
+		{
+			this->capacity = size * 2;
+		}
+
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, this->capacity, NULL, GL_STREAM_DRAW);
+
+		if (size > 0)
+		{
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, commands.data());
+		}
+	}
+
+	// Draws count commands from first on, gl_DrawIDARB counts from 0 in every call.
+	void Draw(GLenum mode, GLsizei first, GLsizei count)
+	{
+		GLStateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, this->bufferId);
+
+		glMultiDrawArraysIndirect(mode, (const void*)(first * sizeof(GLDrawArraysCommand)), count, 0);
+	}
+
+private:
+	GLuint bufferId = 0;
+	GLsizeiptr capacity = 0;
+};
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define GL_FRUSTUM_SSE
+#endif
+
+#include <gl/glm/glm.hpp>
+
+enum class GLFrustumTest
+{
+	Outside,
+	Intersects,
+	Inside
+};
+
+// Planes of a view frustum in world space with their normals pointing inside, for culling
+// bounding spheres and boxes.
+class GLFrustum
+{
+public:
+	static const int PLANE_COUNT = 6;
+
+	// Extracts the planes from the rows of a view-projection matrix, left, right, bottom, top,
+	// near and far. Normalized, so plane distances are world units.
+	void Update(const glm::mat4& viewProjection)
+	{
+		glm::vec4 rows[4];
+
+		for (int i = 0; i < 4; ++i)
+		{
+			rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		}
+
+		for (int i = 0; i < 3; ++i)
+		{
+			this->planes[i * 2] = rows[3] + rows[i];
+			this->planes[i * 2 + 1] = rows[3] - rows[i];
+		}
+
+		for (auto& plane : this->planes)
+		{
+			plane = plane / glm::length(glm::vec3(plane));
+		}
+	}
+
+	bool IsSphereVisible(const glm::vec3& center, float radius) const
+	{
+		for (const auto& plane : this->planes)
+		{
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Per plane, the corner furthest along its normal decides whether the box is outside, the
+	// corner furthest against it whether the box is entirely inside.
+	GLFrustumTest TestBox(const glm::vec3& min, const glm::vec3& max) const
+	{
+		bool bInside = true;
+
+		for (const auto& plane : this->planes)
+		{
+			glm::vec3 normal(plane);
+			glm::vec3 positive(normal.x >= 0.0f ? max.x : min.x, normal.y >= 0.0f ? max.y : min.y, normal.z >= 0.0f ? max.z : min.z);
+			glm::vec3 negative(normal.x >= 0.0f ? min.x : max.x, normal.y >= 0.0f ? min.y : max.y, normal.z >= 0.0f ? min.z : max.z);
+
+			if (glm::dot(normal, positive) + plane.w < 0.0f)
+			{
+				return GLFrustumTest::Outside;
+			}
+
+			if (glm::dot(normal, negative) + plane.w < 0.0f)
+			{
+				bInside = false;
+			}
+		}
+
+		return bInside ? GLFrustumTest::Inside : GLFrustumTest::Intersects;
+	}
+
+	// Four spheres from structure of arrays, bit n is set when sphere n is at least partly inside.
+	int TestSpheres4(const float* x, const float* y, const float* z, const float* radius) const
+	{
+#if defined(GL_FRUSTUM_SSE)
+		__m128 centerX = _mm_loadu_ps(x);
+		__m128 centerY = _mm_loadu_ps(y);
+		__m128 centerZ = _mm_loadu_ps(z);
+		__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius));
+
+		int mask = 0xF;
+
+		for (const auto& plane : this->planes)
+		{
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(plane.x)), _mm_mul_ps(centerY, _mm_set1_ps(plane.y))),
+				_mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+
+			mask &= _mm_movemask_ps(_mm_cmpge_ps(distance, negativeRadius));
+
+			if (mask == 0)
+			{
+				break;
+			}
+		}
+
+		return mask;
+#else
+		int mask = 0;
+
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			if (this->IsSphereVisible(glm::vec3(x[lane], y[lane], z[lane]), radius[lane]))
+			{
+				mask |= 1 << lane;
+			}
+		}
+
+		return mask;
+#endif
+	}
+
+private:
+	glm::vec4 planes[PLANE_COUNT];
+};
\ No newline at end of file
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <iostream>
+
+#include <gl/glew.h>
+
+#include "GLMemoryHelpers.h"
+#include "GLShader.h"
+#include "GLTextureBinder.h"
+#include "GLStateCache.h"
+
+// Render targets of the geometry pass of deferred shading:
+//   albedo    RGBA8    diffuse color and alpha
+//   normal    RGBA16F  world space normal, shininess in w
+//   specular  RGBA8    specular color
+//   depth     24 bit   depth, positions are reconstructed from it
+class GLGBuffer
+{
+public:
+	static const int COLOR_TARGET_COUNT = 3;
+
+	GLGBuffer()
+	{
+		glGenFramebuffers(1, &this->framebufferId);
+		glGenTextures(COLOR_TARGET_COUNT, this->colorIds);
+		glGenTextures(1, &this->depthId);
+	}
+
+	virtual ~GLGBuffer()
+	{
+		for (int i = 0; i < COLOR_TARGET_COUNT; ++i)
+		{
+			GLTextureBinder::Forget(this->colorIds[i]);
+		}
+
+		GLTextureBinder::Forget(this->depthId);
+
+		glDeleteTextures(COLOR_TARGET_COUNT, this->colorIds);
+		glDeleteTextures(1, &this->depthId);
+		glDeleteFramebuffers(1, &this->framebufferId);
+		GLStateCache::ForgetFramebuffer(this->framebufferId);
+	}
+
+	// Reallocates the targets when the size changed.
+	void Resize(int width, int height)
+	{
+		if (width == this->width && height == this->height)
+		{
+			return;
+		}
+
+		this->width = width;
+		this->height = height;
+
+		this->Allocate(this->colorIds[0], GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+		this->Allocate(this->colorIds[1], GL_RGBA16F, GL_RGBA, GL_FLOAT);
+		this->Allocate(this->colorIds[2], GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+		this->Allocate(this->depthId, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT);
+
+		GLuint previousFramebuffer = GLStateCache::GetDrawFramebuffer();
+
+		GLStateCache::BindDrawFramebuffer(this->framebufferId);
+
+		for (int i = 0; i < COLOR_TARGET_COUNT; ++i)
+		{
+			glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, this->colorIds[i], 0);
+		}
+
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->depthId, 0);
+
+		if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "GLGBuffer: Framebuffer Incomplete " << width << "x" << height << std::endl;
+		}
+
+		GLStateCache::BindDrawFramebuffer(previousFramebuffer);
+	}
+
+	// Redirects drawing into the targets and clears them. Unbind returns to the framebuffer
+	// that was bound before.
+	void Bind()
+	{
+		this->previousFramebuffer = GLStateCache::GetDrawFramebuffer();
+		GLStateCache::BindDrawFramebuffer(this->framebufferId);
+
+		const GLenum drawBuffers[COLOR_TARGET_COUNT] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+		glDrawBuffers(COLOR_TARGET_COUNT, drawBuffers);
+
+		const GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		const GLfloat clearDepth = 1.0f;
+
+		for (int i = 0; i < COLOR_TARGET_COUNT; ++i)
+		{
+			glClearBufferfv(GL_COLOR, i, clearColor);
+		}
+
+		glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+	}
+
+	void Unbind()
+	{
+		GLStateCache::BindDrawFramebuffer(this->previousFramebuffer);
+	}
+
+	// Binds the targets for reading in the lighting pass.
+	void BindTextures()
+	{
+		this->BindTexture(GLTextureUnit::GBufferAlbedo, this->colorIds[0]);
+		this->BindTexture(GLTextureUnit::GBufferNormal, this->colorIds[1]);
+		this->BindTexture(GLTextureUnit::GBufferSpecular, this->colorIds[2]);
+		this->BindTexture(GLTextureUnit::GBufferDepth, this->depthId);
+	}
+
+	int GetWidth()
+	{
+		return this->width;
+	}
+
+	int GetHeight()
+	{
+		return this->height;
+	}
+
+private:
+	void Allocate(GLuint textureId, GLint internalFormat, GLenum format, GLenum type)
+	{
+		GLTextureBinder::BindForUpdate(GL_TEXTURE_2D, textureId);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, this->width, this->height, 0, format, type, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	void BindTexture(GLTextureUnit unit, GLuint textureId)
+	{
+		GLTextureBinder::Bind((int)unit, GL_TEXTURE_2D, textureId);
+		GLTextureBinder::BindSampler((int)unit, 0);
+	}
+
+	GLuint framebufferId = 0;
+	GLuint colorIds[COLOR_TARGET_COUNT] = { };
+	GLuint depthId = 0;
+
+	int width = 0;
+	int height = 0;
+
+	GLuint previousFramebuffer = 0;
+};
\ No newline at end of file
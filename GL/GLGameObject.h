@@ -7,9 +7,19 @@
 #include "GLTransform.h"
 #include "GLMesh.h"
 #include "GLMeshRenderer.h"
+#include "GLRenderCommandBuffer.h"
+#include "GLJobSystem.h"
 #include "GLComponent.h"
 
 class GLScene;
+class GLGameObject;
+
+// Work item of GLGameObject::EnqueueParallel, a whole subtree or only the renderer of an object.
+struct GLEnqueuePart
+{
+	GLGameObject* Object = nullptr;
+	bool bSubtree = true;
+};
 
 class GLGameObject
 {
@@ -116,35 +126,124 @@ public:
 		}
 	};
 
-	virtual void Render(const std::string& layer, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const glm::vec3& cameraPosition,
-		        const std::vector<GLSharedPtr<GLLight>>& lights)
+	// Records the mesh renderers of this subtree in the layer, drawing happens once the queue is sorted.
+	// Subtrees with children are recorded as a group, so they can be culled as a whole.
+	virtual void Enqueue(const std::string& layer, GLRenderCommandBuffer& commands)
 	{
-		if (this->transform == nullptr)
+		if (!this->BeginEnqueue(layer))
 		{
 			return;
 		}
 
-		this->transform->Update();
-
-		if (layer != this->layer)
+		if (this->Children.empty())
 		{
+			this->EnqueueRenderer(commands);
 			return;
 		}
 
-		if (!this->bVisible)
+		commands.BeginGroup();
+
+		for (auto& child : this->Children)
+		{
+			child->Enqueue(layer, commands);
+		}
+
+		this->EnqueueRenderer(commands);
+
+		commands.EndGroup();
+	}
+
+	// Same order as Enqueue, with the subtrees split into contiguous runs recorded by parallel jobs,
+	// one run per command buffer. This object's renderer goes into the last buffer.
+	// While there are fewer subtrees than runs, the tree is split one level further down, so a scene
+	// under a single top level object is spread as well. Split objects are not culled as a group.
+	// Runs are balanced by subtree count, not size, so one large subtree still lands on one job.
+	void EnqueueParallel(const std::string& layer, std::vector<GLRenderCommandBuffer>& commandBuffers)
+	{
+		assert(commandBuffers.size() > 1);
+
+		if (!this->BeginEnqueue(layer))
 		{
 			return;
 		}
 
+		int runCount = (int)commandBuffers.size() - 1;
+
+		std::vector<GLEnqueuePart> parts;
+
 		for (auto& child : this->Children)
 		{
-			child->Render(layer, viewMatrix, projectionMatrix, cameraPosition, lights);
+			parts.push_back({ child.get(), true });
 		}
 
-		if (this->meshRenderer != nullptr)
+		int subtreeCount = (int)parts.size();
+
+		while (subtreeCount < runCount)
 		{
-			this->meshRenderer->Render(this->transform->LocalToWorldMatrix, viewMatrix, projectionMatrix, cameraPosition, lights);
+			std::vector<GLEnqueuePart> split;
+			int splitCount = 0;
+			bool bSplit = false;
+
+			for (auto& part : parts)
+			{
+				if (!part.bSubtree || part.Object->Children.empty())
+				{
+					split.push_back(part);
+					splitCount += part.bSubtree ? 1 : 0;
+					continue;
+				}
+
+				bSplit = true;
+
+				// The transform is updated here, before the jobs update its children.
+				if (!part.Object->BeginEnqueue(layer))
+				{
+					continue;
+				}
+
+				for (auto& child : part.Object->Children)
+				{
+					split.push_back({ child.get(), true });
+				}
+
+				split.push_back({ part.Object, false });
+				splitCount += (int)part.Object->Children.size();
+			}
+
+			if (!bSplit)
+			{
+				break;
+			}
+
+			parts.swap(split);
+			subtreeCount = splitCount;
 		}
+
+		int partCount = (int)parts.size();
+
+		GLJobSystem::ParallelFor(runCount, 1,
+			[&parts, &layer, &commandBuffers, runCount, partCount](int begin, int end, int /*worker*/)
+			{
+				for (int run = begin; run < end; ++run)
+				{
+					int last = (run + 1) * partCount / runCount;
+
+					for (int i = run * partCount / runCount; i < last; ++i)
+					{
+						if (parts[i].bSubtree)
+						{
+							parts[i].Object->Enqueue(layer, commandBuffers[run]);
+						}
+						else
+						{
+							parts[i].Object->EnqueueRenderer(commandBuffers[run]);
+						}
+					}
+				}
+			}
+		);
+
+		this->EnqueueRenderer(commandBuffers.back());
 	}
 
 	GLSharedPtr<GLTransform> GetParent()
@@ -172,6 +271,11 @@ public:
 		child->SetParent(this->transform);
 
 		this->Children.push_back(child);
+
+		if (child->HasStaticContent())
+		{
+			MarkStaticChanged();
+		}
 	}
 
 	void AddChildren(const std::initializer_list<GLSharedPtr<GLGameObject>>& children)
@@ -195,6 +299,11 @@ public:
 
 			this->Children.erase(position);
 		}
+
+		if (child->HasStaticContent())
+		{
+			MarkStaticChanged();
+		}
 	}
 
 	void RemoveChildren(const std::initializer_list<GLSharedPtr<GLGameObject>>& children)
@@ -207,6 +316,15 @@ public:
 
 	void ClearChildren()
 	{
+		for (const auto& child : this->Children)
+		{
+			if (child->HasStaticContent())
+			{
+				MarkStaticChanged();
+				break;
+			}
+		}
+
 		this->Children.clear();
 	}
 	
@@ -217,14 +335,82 @@ public:
 
 	void SetLayer(const std::string& layer)
 	{
+		if (this->layer != layer && this->HasStaticContent())
+		{
+			MarkStaticChanged();
+		}
+
 		this->layer = layer;
 	}
 
 	void SetVisible(bool bVisible)
 	{
+		if (this->bVisible != bVisible && this->HasStaticContent())
+		{
+			MarkStaticChanged();
+		}
+
 		this->bVisible = bVisible;
 	}
 
+	bool IsStatic()
+	{
+		return this->bStatic;
+	}
+
+	// Static objects never move once added to the scene, their meshes are merged by material into
+	// world space batches. Call MarkStaticChanged after editing the mesh or material of one.
+	void SetStatic(bool bStatic)
+	{
+		if (this->bStatic != bStatic)
+		{
+			MarkStaticChanged();
+		}
+
+		this->bStatic = bStatic;
+	}
+
+	bool IsStaticBatched()
+	{
+		return this->bStaticBatched;
+	}
+
+	// Set by GLStaticBatcher for objects drawn as part of a batch.
+	void SetStaticBatched(bool bStaticBatched)
+	{
+		this->bStaticBatched = bStaticBatched;
+	}
+
+	// Whether this object or one below it is static.
+	bool HasStaticContent()
+	{
+		if (this->bStatic)
+		{
+			return true;
+		}
+
+		for (const auto& child : this->Children)
+		{
+			if (child->HasStaticContent())
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Bumped by every change to static objects, batches are rebuilt when it moves on.
+	static unsigned int GetStaticVersion()
+	{
+		return staticVersion;
+	}
+
+	static void MarkStaticChanged()
+	{
+		staticVersion++;
+	}
+
 	bool IsVisible()
 	{
 		return this->bVisible;
@@ -263,6 +449,28 @@ public:
 	std::vector<GLSharedPtr<GLGameObject>> Children;
 
 private:
+	// Updates the transform, the subtree is only drawn if it is visible in the layer.
+	bool BeginEnqueue(const std::string& layer)
+	{
+		if (this->transform == nullptr)
+		{
+			return false;
+		}
+
+		this->transform->Update();
+
+		return layer == this->layer && this->bVisible;
+	}
+
+	// Static batches are queued by the scene in place of their objects.
+	void EnqueueRenderer(GLRenderCommandBuffer& commands)
+	{
+		if (this->meshRenderer != nullptr && !this->bStaticBatched)
+		{
+			commands.Add(this->meshRenderer, this->transform->LocalToWorldMatrix);
+		}
+	}
+
 	GLSharedPtr<GLScene> scene = nullptr;
 	GLSharedPtr<GLTransform> transform = nullptr;
 	GLSharedPtr<GLMeshRenderer> meshRenderer = nullptr;
@@ -272,9 +480,16 @@ private:
 	bool bVisible = true;
 	std::string layer = "Default";
 
+	bool bStatic = false;
+	bool bStaticBatched = false;
+
 	bool bInitialized = false;
+
+	static unsigned int staticVersion;
 };
 
+unsigned int GLGameObject::staticVersion = 0;
+
 #define GConstructor(CLASSNAME, ...) \
 CLASSNAME(const GLSharedPtr<GLTransform>& parent, ## __VA_ARGS__)
 
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include <gl/glew.h>
+#include <gl/glm/glm.hpp>
+
+#include "GLMesh.h"
+#include "GLStateCache.h"
+
+// One vertex of the pool, the attributes of GLMesh interleaved at the same locations.
+struct GLPoolVertex
+{
+	glm::vec4 Position;
+	glm::vec4 Color;
+	glm::vec4 Normal;
+	glm::vec2 UV;
+};
+
+// Vertices of one mesh in the pool, the first and count arguments of its draw.
+struct GLGeometryRange
+{
+	GLuint First = 0;
+	GLuint Count = 0;
+};
+
+struct GLGeometryPoolStats
+{
+	size_t Meshes = 0;
+	size_t Uploads = 0;
+
+	// Vertices in use, left behind by meshes that moved, and allocated.
+	size_t Vertices = 0;
+	size_t WastedVertices = 0;
+	size_t Capacity = 0;
+};
+
+// Vertices of many meshes in a single buffer behind one vertex array, so draws of different
+// meshes need no vertex array switch and can be issued by one multi-draw call. Meshes are copied
+// in on first use and again after they changed, in place while they keep fitting.
+class GLGeometryPool
+{
+public:
+	static const GLuint MIN_CAPACITY = 1 << 16;
+
+	GLGeometryPool()
+	{
+		glGenVertexArrays(1, &this->vertexArrayId);
+		glGenBuffers(1, &this->bufferId);
+	}
+
+	virtual ~GLGeometryPool()
+	{
+		glDeleteBuffers(1, &this->bufferId);
+		GLStateCache::ForgetBuffer(this->bufferId);
+		glDeleteVertexArrays(1, &this->vertexArrayId);
+		GLStateCache::ForgetVertexArray(this->vertexArrayId);
+	}
+
+	// Range of the mesh in the pool, uploading its pending changes first. Ranges handed out
+	// earlier are invalid once the generation changed, see Compact.
+	GLGeometryRange Prepare(GLMesh& mesh)
+	{
+		mesh.Flush();
+
+		GLuint count = (GLuint)mesh.GetIndexCount();
+		auto found = this->entries.find(mesh.GetSortId());
+
+		if (found != this->entries.end())
+		{
+			auto& entry = found->second;
+
+			if (entry.Version == mesh.GetVersion())
+			{
+				return entry.Range;
+			}
+
+			if (count <= entry.Range.Count)
+			{
+				this->wasted += entry.Range.Count - count;
+
+				entry.Range.Count = count;
+				entry.Version = mesh.GetVersion();
+
+				this->Upload(mesh, entry.Range);
+
+				return entry.Range;
+			}
+
+			this->wasted += entry.Range.Count;
+		}
+
+		GLPoolEntry entry;
+		entry.Range.First = this->Allocate(count);
+		entry.Range.Count = count;
+		entry.Version = mesh.GetVersion();
+
+		this->entries[mesh.GetSortId()] = entry;
+
+		this->Upload(mesh, entry.Range);
+
+		return entry.Range;
+	}
+
+	// Changes whenever the pool was emptied and every mesh has to be prepared again.
+	unsigned int GetGeneration()
+	{
+		return this->generation;
+	}
+
+	void Bind()
+	{
+		GLStateCache::BindVertexArray(this->vertexArrayId);
+	}
+
+	GLGeometryPoolStats GetStats()
+	{
+		GLGeometryPoolStats stats;
+		stats.Meshes = this->entries.size();
+		stats.Uploads = this->uploads;
+		stats.Vertices = this->used - this->wasted;
+		stats.WastedVertices = this->wasted;
+		stats.Capacity = this->capacity;
+
+		return stats;
+	}
+
+private:
+	struct GLPoolEntry
+	{
+		GLGeometryRange Range;
+		unsigned int Version = 0;
+	};
+
+	// Space for count vertices at the end. A full pool that is mostly left behind by meshes that
+	// moved is emptied instead of grown, which also drops the meshes no longer drawn.
+	GLuint Allocate(GLuint count)
+	{
+		if (this->used + count > this->capacity && this->wasted > this->used / 2)
+		{
+			this->Compact();
+		}
+
+		if (this->used + count > this->capacity)
+		{
+			this->Grow(std::max({ this->capacity * 2, this->used + count, MIN_CAPACITY }));
+		}
+
+		GLuint first = this->used;
+		this->used += count;
+
+		return first;
+	}
+
+	void Compact()
+	{
+		this->entries.clear();
+
+		this->used = 0;
+		this->wasted = 0;
+
+		this->generation++;
+	}
+
+	// Moves the vertices in use into a larger buffer, the copy stays on the GPU.
+	void Grow(GLuint capacity)
+	{
+		GLuint bufferId = 0;
+		glGenBuffers(1, &bufferId);
+
+		GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, bufferId);
+		glBufferData(GL_COPY_WRITE_BUFFER, capacity * sizeof(GLPoolVertex), NULL, GL_DYNAMIC_DRAW);
+
+		if (this->used > 0)
+		{
+			GLStateCache::BindBuffer(GL_COPY_READ_BUFFER, this->bufferId);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, this->used * sizeof(GLPoolVertex));
+		}
+
+		glDeleteBuffers(1, &this->bufferId);
+		GLStateCache::ForgetBuffer(this->bufferId);
+
+		this->bufferId = bufferId;
+		this->capacity = capacity;
+
+		GLsizei stride = sizeof(GLPoolVertex);
+
+		GLStateCache::BindVertexArray(this->vertexArrayId);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, this->bufferId);
+
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(GLPoolVertex, Position));
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(GLPoolVertex, Color));
+		glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(GLPoolVertex, Normal));
+		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(GLPoolVertex, UV));
+
+		for (GLuint i = 0; i < 4; ++i)
+		{
+			glEnableVertexAttribArray(i);
+		}
+
+		GLStateCache::BindVertexArray(0);
+	}
+
+	// Same vertices as the buffers of GLMesh: positions are looked up through the indices, colors,
+	// normals and uvs are taken in order, missing ones are zero.
+	void Upload(GLMesh& mesh, const GLGeometryRange& range)
+	{
+		const auto& vertices = mesh.GetVertices();
+		const auto& colors = mesh.GetColors();
+		const auto& normals = mesh.GetNormals();
+		const auto& uvs = mesh.GetUVs();
+		const auto& indices = mesh.GetIndices();
+
+		this->scratch.assign(range.Count, GLPoolVertex());
+
+		for (GLuint i = 0; i < range.Count; ++i)
+		{
+			auto& vertex = this->scratch[i];
+
+			vertex.Position = glm::vec4(vertices[indices[i]], 1.0f);
+			vertex.Color = i < colors.size() ? glm::vec4(colors[i].r, colors[i].g, colors[i].b, colors[i].a) : glm::vec4(0.0f);
+			vertex.Normal = i < normals.size() ? glm::vec4(normals[i], 1.0f) : glm::vec4(0.0f);
+			vertex.UV = i < uvs.size() ? uvs[i] : glm::vec2(0.0f);
+		}
+
+		if (range.Count > 0)
+		{
+			GLStateCache::BindBuffer(GL_ARRAY_BUFFER, this->bufferId);
+			glBufferSubData(GL_ARRAY_BUFFER, range.First * sizeof(GLPoolVertex), range.Count * sizeof(GLPoolVertex), this->scratch.data());
+		}
+
+		this->uploads++;
+	}
+
+	GLuint vertexArrayId = 0;
+	GLuint bufferId = 0;
+
+	GLuint capacity = 0;
+	GLuint used = 0;
+	GLuint wasted = 0;
+
+	unsigned int generation = 0;
+	size_t uploads = 0;
+
+	std::unordered_map<unsigned int, GLPoolEntry> entries;
+	std::vector<GLPoolVertex> scratch;
+};
\ No newline at end of file
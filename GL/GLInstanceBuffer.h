@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+
+#include <gl/glew.h>
+#include <gl/glm/glm.hpp>
+
+#include "GLMemoryHelpers.h"
+#include "GLStateCache.h"
+
+// Per instance attributes of the INSTANCED shader variants. The material colors travel with
+// the instance, so objects with different materials of the same kind still share a draw.
+struct GLInstanceData
+{
+	glm::mat4 Model;
+
+	// Diffuse color, w is the diffuse map array layer.
+	glm::vec4 Diffuse;
+
+	// Specular color, w is the shininess.
+	glm::vec4 Specular;
+};
+
+// Vertex buffer of instance attributes, read at locations 4 to 9 with a divisor of 1:
+//   4-7  model matrix columns
+//   8    diffuse
+//   9    specular
+// Multi-draw variants read the same buffer as their Draws storage block instead.
+class GLInstanceBuffer
+{
+public:
+	static const GLuint FIRST_ATTRIBUTE = 4;
+
+	GLInstanceBuffer()
+	{
+		glGenBuffers(1, &this->bufferId);
+	}
+
+	virtual ~GLInstanceBuffer()
+	{
+		glDeleteBuffers(1, &this->bufferId);
+		GLStateCache::ForgetBuffer(this->bufferId);
+	}
+
+	// Replaces the contents. The storage is orphaned so drawing the previous frame never stalls the upload.
+	void Update(const std::vector<GLInstanceData>& instances)
+	{
+		GLsizeiptr size = instances.size() * sizeof(GLInstanceData);
+
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, this->bufferId);
+
+		if (size > this->capacity)
+		{
+			this->capacity = size * 2;
+		}
+
+		glBufferData(GL_ARRAY_BUFFER, this->capacity, NULL, GL_STREAM_DRAW);
+
+		if (size > 0)
+		{
+			glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances.data());
+		}
+	}
+
+	// Points the instance attributes of the bound vertex array at the instances from first on.
+	void BindAttributes(GLsizei first)
+	{
+		GLsizei stride = sizeof(GLInstanceData);
+		GLintptr offset = first * sizeof(GLInstanceData);
+
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, this->bufferId);
+
+		for (GLuint i = 0; i < 6; ++i)
+		{
+			glVertexAttribPointer(FIRST_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, stride, (const void*)(offset + i * sizeof(glm::vec4)));
+			glVertexAttribDivisor(FIRST_ATTRIBUTE + i, 1);
+			glEnableVertexAttribArray(FIRST_ATTRIBUTE + i);
+		}
+	}
+
+	// Binds the whole buffer to a shader storage binding point, see DrawData.glsl.
+	void BindStorage(GLuint binding)
+	{
+		GLStateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, this->bufferId);
+	}
+
+	GLuint GetBufferId()
+	{
+		return this->bufferId;
+	}
+
+private:
+	GLuint bufferId = 0;
+	GLsizeiptr capacity = 0;
+};
\ No newline at end of file
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gl/glm/glm.hpp>
+
+#include "core/Singleton.h"
+
+// Work on the range [begin, end), worker is 0 for the calling thread and unique per thread.
+typedef std::function<void(int begin, int end, int worker)> GLRangeJob;
+
+// Persistent worker threads for splitting CPU side frame work. The calling thread works as well
+// and returns once every range is done. Jobs must not touch GL, which stays on the calling thread.
+class GLJobSystem : public Singleton<GLJobSystem>
+{
+public:
+	GLJobSystem()
+	{
+		int threadCount = (int)std::thread::hardware_concurrency();
+
+		for (int i = 1; i < threadCount; ++i)
+		{
+			this->workers.emplace_back(&GLJobSystem::Work, this, i);
+		}
+	}
+
+	~GLJobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->bStopping = true;
+		}
+
+		this->wake.notify_all();
+
+		for (auto& worker : this->workers)
+		{
+			worker.join();
+		}
+	}
+
+	// Splits [0, count) into ranges of at least minRange items and runs them on all threads.
+	static void ParallelFor(int count, int minRange, const GLRangeJob& job)
+	{
+		GetInstance()->Run(count, minRange, job);
+	}
+
+	// Threads running a job, including the calling thread.
+	static int GetThreadCount()
+	{
+		return (int)GetInstance()->workers.size() + 1;
+	}
+
+private:
+	void Run(int count, int minRange, const GLRangeJob& job)
+	{
+		if (count <= 0)
+		{
+			return;
+		}
+
+		int threadCount = (int)this->workers.size() + 1;
+
+		if (threadCount == 1 || count <= minRange || this->bRunning)
+		{
+			// Nested jobs run inline.
+			job(0, count, 0);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			this->job = &job;
+			this->count = count;
+			this->rangeSize = glm::max(minRange, (count + threadCount * 4 - 1) / (threadCount * 4));
+			this->nextBegin = 0;
+			this->busyWorkers = (int)this->workers.size();
+			this->generation++;
+			this->bRunning = true;
+		}
+
+		this->wake.notify_all();
+
+		this->RunRanges(0);
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		this->done.wait(lock, [this]() { return this->busyWorkers == 0; });
+
+		this->job = nullptr;
+		this->bRunning = false;
+	}
+
+	void RunRanges(int worker)
+	{
+		while (true)
+		{
+			int begin = this->nextBegin.fetch_add(this->rangeSize);
+
+			if (begin >= this->count)
+			{
+				return;
+			}
+
+			(*this->job)(begin, glm::min(begin + this->rangeSize, this->count), worker);
+		}
+	}
+
+	void Work(int worker)
+	{
+		uint64_t seenGeneration = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+
+				this->wake.wait(lock, [this, seenGeneration]() { return this->bStopping || this->generation != seenGeneration; });
+
+				if (this->bStopping)
+				{
+					return;
+				}
+
+				seenGeneration = this->generation;
+			}
+
+			this->RunRanges(worker);
+
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+
+				if (--this->busyWorkers == 0)
+				{
+					this->done.notify_one();
+				}
+			}
+		}
+	}
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	const GLRangeJob* job = nullptr;
+	int count = 0;
+	int rangeSize = 1;
+	std::atomic<int> nextBegin { 0 };
+	int busyWorkers = 0;
+
+	uint64_t generation = 0;
+	bool bRunning = false;
+	bool bStopping = false;
+};
\ No newline at end of file
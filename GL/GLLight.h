@@ -1,7 +1,56 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
 #include <gl/glm/glm.hpp>
 
+#include "GLMemoryHelpers.h"
+#include "GLShader.h"
+#include "GLBasicShader.h"
+
+// std140 layouts of the Lights block in shaders/Lighting.glsl. Scalars ride in the w
+// components so every light is a few vec4s.
+struct GLDirectionalLightData
+{
+	glm::vec4 Direction;
+	glm::vec4 Ambient;
+	glm::vec4 Diffuse;
+	glm::vec4 Specular;
+};
+
+// Position.w is the constant, Ambient.w the linear and Diffuse.w the quadratic attenuation term.
+struct GLPointLightData
+{
+	glm::vec4 Position;
+	glm::vec4 Ambient;
+	glm::vec4 Diffuse;
+	glm::vec4 Specular;
+};
+
+// As GLPointLightData, Direction.w is the inner and Specular.w the outer cut off.
+struct GLSpotLightData
+{
+	glm::vec4 Position;
+	glm::vec4 Direction;
+	glm::vec4 Ambient;
+	glm::vec4 Diffuse;
+	glm::vec4 Specular;
+};
+
+// The arrays hold the first MAX_LIGHT_COUNT lights of each type. Clustered shading reads every
+// point and spot light from the light data texture buffer instead.
+struct GLLightBlock
+{
+	// Directional, point and spot light counts in the arrays, w is the total point light count.
+	glm::tvec4<int> Counts;
+
+	GLDirectionalLightData DirectionalLights[GLMaterialShader::MAX_LIGHT_COUNT];
+	GLPointLightData PointLights[GLMaterialShader::MAX_LIGHT_COUNT];
+	GLSpotLightData SpotLights[GLMaterialShader::MAX_LIGHT_COUNT];
+};
+
 class GLLight
 {
 public:
@@ -33,29 +82,25 @@ public:
 	void SetAmbient(const glm::vec3& ambient)
 	{
 		this->ambient = ambient;
+		this->MarkChanged();
 	}
 
 	void SetDiffuse(const glm::vec3& diffuse)
 	{
 		this->diffuse = diffuse;
+		this->MarkChanged();
 	}
 
 	void SetSpecular(const glm::vec3& specular)
 	{
 		this->specular = specular;
+		this->MarkChanged();
 	}
 
-	virtual void Apply(const GLSharedPtr<GLShader>& shader, int index) = 0;
-
-	template <typename T>
-	void ApplyUniform(const GLSharedPtr<GLShader>& shader, const std::string& name, T value)
+	// Incremented by every setter, so packed light data is only rebuilt when something changed.
+	uint64_t GetVersion()
 	{
-		int location = shader->GetUniformLocation(name);
-
-		if (location >= 0)
-		{
-			shader->SetUniform(location, value);
-		}
+		return this->version;
 	}
 
 	bool GetActive()
@@ -66,6 +111,13 @@ public:
 	void SetActive(bool active)
 	{
 		this->bIsActive = active;
+		this->MarkChanged();
+	}
+
+protected:
+	void MarkChanged()
+	{
+		this->version++;
 	}
 
 private:
@@ -74,6 +126,8 @@ private:
 	glm::vec3 specular = glm::vec3(1.0f);
 
 	bool bIsActive = true;
+
+	uint64_t version = 0;
 };
 
 class GLDirectionalLight : public GLLight
@@ -89,24 +143,12 @@ public:
 
 	}
 
-	void Apply(const GLSharedPtr<GLShader>& shader, int index) override
+	void Write(GLDirectionalLightData& data)
 	{
-		if (!this->GetActive())
-		{
-			return;
-		}
-
-		std::string prefix = "directionalLights[" + std::to_string(index) + "]";
-
-		std::string ambientUniformName = prefix + "." + "ambient";
-		std::string diffuseUniformName = prefix + "." + "diffuse";
-		std::string specularUniformName = prefix + "." + "specular";
-		std::string directionUniformName = prefix + "." + "direction";
-
-		this->ApplyUniform(shader, ambientUniformName, this->GetAmbient());
-		this->ApplyUniform(shader, diffuseUniformName, this->GetDiffuse());
-		this->ApplyUniform(shader, specularUniformName, this->GetSpecular());
-		this->ApplyUniform(shader, directionUniformName, this->GetDirection());
+		data.Direction = glm::vec4(this->GetDirection(), 0.0f);
+		data.Ambient = glm::vec4(this->GetAmbient(), 0.0f);
+		data.Diffuse = glm::vec4(this->GetDiffuse(), 0.0f);
+		data.Specular = glm::vec4(this->GetSpecular(), 0.0f);
 	}
 
 	glm::vec3 GetDirection()
@@ -117,6 +159,7 @@ public:
 	void SetDirection(const glm::vec3& direction)
 	{
 		this->direction = direction;
+		this->MarkChanged();
 	}
 
 private:
@@ -136,30 +179,12 @@ public:
 
 	}
 
-	void Apply(const GLSharedPtr<GLShader>& shader, int index)
+	void Write(GLPointLightData& data)
 	{
-		if (!this->GetActive())
-		{
-			return;
-		}
-
-		std::string prefix = "pointLights[" + std::to_string(index) + "]";
-
-		std::string ambientUniformName = prefix + "." + "ambient";
-		std::string diffuseUniformName = prefix + "." + "diffuse";
-		std::string specularUniformName = prefix + "." + "specular";
-		std::string positionUniformName = prefix + "." + "position";
-		std::string constantUniformName = prefix + "." + "constant";
-		std::string linearUniformName = prefix + "." + "linear";
-		std::string quadraticUniformName = prefix + "." + "quadratic";
-
-		this->ApplyUniform(shader, ambientUniformName, this->GetAmbient());
-		this->ApplyUniform(shader, diffuseUniformName, this->GetDiffuse());
-		this->ApplyUniform(shader, specularUniformName, this->GetSpecular());
-		this->ApplyUniform(shader, positionUniformName, this->GetPosition());
-		this->ApplyUniform(shader, constantUniformName, this->GetConstant());
-		this->ApplyUniform(shader, linearUniformName, this->GetLinear());
-		this->ApplyUniform(shader, quadraticUniformName, this->GetQuadratic());
+		data.Position = glm::vec4(this->GetPosition(), this->GetConstant());
+		data.Ambient = glm::vec4(this->GetAmbient(), this->GetLinear());
+		data.Diffuse = glm::vec4(this->GetDiffuse(), this->GetQuadratic());
+		data.Specular = glm::vec4(this->GetSpecular(), 0.0f);
 	}
 
 	float GetConstant()
@@ -185,21 +210,25 @@ public:
 	void SetConstant(float constant)
 	{
 		this->constant = constant;
+		this->MarkChanged();
 	}
 
 	void SetLinear(float linear)
 	{
 		this->linear = linear;
+		this->MarkChanged();
 	}
 
 	void SetQuadratic(float quadratic)
 	{
 		this->quadratic = quadratic;
+		this->MarkChanged();
 	}
 
 	void SetPosition(const glm::vec3& position)
 	{
 		this->position = position;
+		this->MarkChanged();
 	}
 
 private:
@@ -223,34 +252,24 @@ public:
 
 	}
 
-	void Apply(const GLSharedPtr<GLShader>& shader, int index)
+	void Write(GLSpotLightData& data)
 	{
-		if (!this->GetActive())
-		{
-			return;
-		}
+		data.Position = glm::vec4(this->GetPosition(), this->GetConstant());
+		data.Direction = glm::vec4(this->GetDirection(), this->GetCutOff());
+		data.Ambient = glm::vec4(this->GetAmbient(), this->GetLinear());
+		data.Diffuse = glm::vec4(this->GetDiffuse(), this->GetQuadratic());
+		data.Specular = glm::vec4(this->GetSpecular(), this->GetOuterCutOff());
+	}
+
+	glm::vec3 GetDirection()
+	{
+		return this->direction;
+	}
 
-		std::string prefix = "spotLights[" + std::to_string(index) + "]";
-
-		std::string ambientUniformName = prefix + "." + "ambient";
-		std::string diffuseUniformName = prefix + "." + "diffuse";
-		std::string specularUniformName = prefix + "." + "specular";
-		std::string positionUniformName = prefix + "." + "position";
-		std::string constantUniformName = prefix + "." + "constant";
-		std::string linearUniformName = prefix + "." + "linear";
-		std::string quadraticUniformName = prefix + "." + "quadratic";
-		std::string cutOffUniformName = prefix + "." + "cutOff";
-		std::string outerCutOffUniformName = prefix + "." + "outerCutOff";
-
-		this->ApplyUniform(shader, ambientUniformName, this->GetAmbient());
-		this->ApplyUniform(shader, diffuseUniformName, this->GetDiffuse());
-		this->ApplyUniform(shader, specularUniformName, this->GetSpecular());
-		this->ApplyUniform(shader, positionUniformName, this->GetPosition());
-		this->ApplyUniform(shader, constantUniformName, this->GetConstant());
-		this->ApplyUniform(shader, linearUniformName, this->GetLinear());
-		this->ApplyUniform(shader, quadraticUniformName, this->GetQuadratic());
-		this->ApplyUniform(shader, cutOffUniformName, this->GetCutOff());
-		this->ApplyUniform(shader, outerCutOffUniformName, this->GetOuterCutOff());
+	void SetDirection(const glm::vec3& direction)
+	{
+		this->direction = direction;
+		this->MarkChanged();
 	}
 
 	float GetCutOff()
@@ -266,14 +285,78 @@ public:
 	void SetCutOff(float cutOff)
 	{
 		this->cutOff = cutOff;
+		this->MarkChanged();
 	}
 
 	void SetOuterCutOff(float outerCutOff)
 	{
 		this->outerCutOff = outerCutOff;
+		this->MarkChanged();
 	}
 
 private:
+	glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+
 	float cutOff = 0.0f;
 	float outerCutOff = 0.0f;
+};
+
+// Contiguous lights of one type. The version changes whenever a light is added, removed or
+// modified and never repeats, so consumers can keep what they built from an older version.
+template <typename T>
+class GLLightList
+{
+public:
+	void Add(const GLSharedPtr<T>& light)
+	{
+		this->lights.push_back(light);
+		this->version++;
+	}
+
+	bool Remove(const GLSharedPtr<GLLight>& light)
+	{
+		auto position = std::find_if(this->lights.begin(), this->lights.end(),
+			[&light](const GLSharedPtr<T>& entry)
+			{
+				return entry.get() == light.get();
+			}
+		);
+
+		if (position == this->lights.end())
+		{
+			return false;
+		}
+
+		// The removed light no longer adds its own version, keep the sum growing.
+		this->version += (*position)->GetVersion() + 1;
+		this->lights.erase(position);
+
+		return true;
+	}
+
+	const std::vector<GLSharedPtr<T>>& Get() const
+	{
+		return this->lights;
+	}
+
+	size_t GetCount() const
+	{
+		return this->lights.size();
+	}
+
+	uint64_t GetVersion() const
+	{
+		uint64_t sum = this->version;
+
+		for (const auto& light : this->lights)
+		{
+			sum += light->GetVersion();
+		}
+
+		return sum;
+	}
+
+private:
+	std::vector<GLSharedPtr<T>> lights;
+	uint64_t version = 0;
 };
\ No newline at end of file
@@ -0,0 +1,400 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include <gl/glew.h>
+
+#include "GLMemoryHelpers.h"
+#include "GLLight.h"
+#include "GLUniformBuffer.h"
+#include "GLTextureBuffer.h"
+
+// Region a point or spot light can visibly affect, derived from its attenuation when packed.
+struct GLLightInfluence
+{
+	glm::vec3 Position = glm::vec3(0.0f);
+	float Range = 0.0f;
+
+	// Spot lights only, the cone of the outer cut off.
+	glm::vec3 Direction = glm::vec3(0.0f);
+	float CosOuterCutOff = -1.0f;
+	float SinOuterCutOff = 0.0f;
+
+	float Intensity = 0.0f;
+	glm::vec3 Attenuation = glm::vec3(1.0f, 0.0f, 0.0f);
+};
+
+// Point and spot lights picked for one object, as indices into the light data texture buffer.
+struct GLLightSelection
+{
+	int PointCount = 0;
+	int SpotCount = 0;
+
+	int PointIndices[GLMaterialShader::MAX_LIGHT_COUNT];
+	int SpotIndices[GLMaterialShader::MAX_LIGHT_COUNT];
+};
+
+// Active scene lights packed into the Lights uniform block. Each light type is repacked only
+// when its list version changed. Draws only read the counts to pick a shader variant, no light
+// uniforms are set per object. The block holds MAX_LIGHT_COUNT lights per type, every point and
+// spot light is also kept for the light data texture buffer read by light lists and clustered shading.
+class GLLightBuffer
+{
+public:
+	GLLightBuffer()
+	{
+		this->uniformBuffer = GLCreate<GLUniformBuffer>(sizeof(GLLightBlock));
+		this->lightData = GLCreate<GLTextureBuffer>(GL_RGBA32F);
+
+		this->block.Counts = glm::tvec4<int>(0);
+	}
+
+	void Update(const GLLightList<GLDirectionalLight>& lights)
+	{
+		this->Pack(lights, this->directionalData, this->block.Counts.x, this->block.DirectionalLights, offsetof(GLLightBlock, DirectionalLights), this->directionalVersion);
+	}
+
+	void Update(const GLLightList<GLPointLight>& lights)
+	{
+		if (this->Pack(lights, this->pointData, this->block.Counts.y, this->block.PointLights, offsetof(GLLightBlock, PointLights), this->pointVersion))
+		{
+			this->UpdateInfluences(this->pointData, this->pointInfluences);
+			this->bLightDataDirty = true;
+		}
+	}
+
+	void Update(const GLLightList<GLSpotLight>& lights)
+	{
+		if (this->Pack(lights, this->spotData, this->block.Counts.z, this->block.SpotLights, offsetof(GLLightBlock, SpotLights), this->spotVersion))
+		{
+			this->UpdateInfluences(this->spotData, this->spotInfluences);
+			this->bLightDataDirty = true;
+		}
+	}
+
+	void Bind()
+	{
+		this->uniformBuffer->Bind(GLUniformBlockBinding::Lights);
+	}
+
+	// Uploads every point and spot light as RGBA32F texels when they changed: four per point
+	// light, followed by five per spot light, in the layout of the block structs.
+	void BindLightData()
+	{
+		if (this->bLightDataDirty)
+		{
+			this->texels.clear();
+
+			for (const auto& data : this->pointData)
+			{
+				this->texels.insert(this->texels.end(), { data.Position, data.Ambient, data.Diffuse, data.Specular });
+			}
+
+			for (const auto& data : this->spotData)
+			{
+				this->texels.insert(this->texels.end(), { data.Position, data.Direction, data.Ambient, data.Diffuse, data.Specular });
+			}
+
+			this->lightData->Update(this->texels.data(), this->texels.size() * sizeof(glm::vec4));
+			this->bLightDataDirty = false;
+		}
+
+		this->lightData->Bind((int)GLTextureUnit::LightData);
+	}
+
+	// Lights in the block arrays, at most MAX_LIGHT_COUNT each.
+	int GetDirectionalCount() const
+	{
+		return this->block.Counts.x;
+	}
+
+	int GetPointCount() const
+	{
+		return this->block.Counts.y;
+	}
+
+	int GetSpotCount() const
+	{
+		return this->block.Counts.z;
+	}
+
+	// Every active light, including those beyond the block arrays.
+	int GetTotalPointCount() const
+	{
+		return (int)this->pointData.size();
+	}
+
+	int GetTotalSpotCount() const
+	{
+		return (int)this->spotData.size();
+	}
+
+	const GLLightBlock& GetBlock() const
+	{
+		return this->block;
+	}
+
+	// Picks the point and spot lights with the strongest estimated contribution to a sphere in world
+	// space, at most maxCount in total, from every active light including those beyond the block arrays.
+	// Lights whose influence does not reach the sphere are skipped. Called by recording jobs as well.
+	void Select(const glm::vec3& center, float radius, int maxCount, GLLightSelection& selection) const
+	{
+		// The strongest lights so far, ordered by score.
+		Candidate selected[GLMaterialShader::MAX_LIGHT_COUNT];
+		int selectedCount = 0;
+
+		maxCount = glm::min(maxCount, GLMaterialShader::MAX_LIGHT_COUNT);
+
+		for (int i = 0; i < (int)this->pointInfluences.size(); ++i)
+		{
+			Insert({ GetScore(this->pointInfluences[i], center, radius), i, false }, maxCount, selected, selectedCount);
+		}
+
+		for (int i = 0; i < (int)this->spotInfluences.size(); ++i)
+		{
+			Insert({ GetScore(this->spotInfluences[i], center, radius), i, true }, maxCount, selected, selectedCount);
+		}
+
+		selection.PointCount = 0;
+		selection.SpotCount = 0;
+
+		for (int i = 0; i < selectedCount; ++i)
+		{
+			if (selected[i].bSpot)
+			{
+				selection.SpotIndices[selection.SpotCount++] = selected[i].Index;
+			}
+			else
+			{
+				selection.PointIndices[selection.PointCount++] = selected[i].Index;
+			}
+		}
+	}
+
+	const GLLightInfluence& GetPointInfluence(int index) const
+	{
+		return this->pointInfluences[index];
+	}
+
+	const GLLightInfluence& GetSpotInfluence(int index) const
+	{
+		return this->spotInfluences[index];
+	}
+
+	// Contribution below which a light is treated as having no effect, relative to full intensity.
+	static float GetInfluenceThreshold()
+	{
+		return influenceThreshold;
+	}
+
+	static void SetInfluenceThreshold(float threshold)
+	{
+		influenceThreshold = threshold;
+	}
+
+	// Number of times a light array was rebuilt and uploaded.
+	size_t GetPackCount() const
+	{
+		return this->packCount;
+	}
+
+private:
+	struct Candidate
+	{
+		float Score;
+		int Index;
+		bool bSpot;
+	};
+
+	// Keeps the maxCount strongest candidates in order, earlier lights win ties.
+	static void Insert(const Candidate& candidate, int maxCount, Candidate* selected, int& selectedCount)
+	{
+		if (candidate.Score <= 0.0f || maxCount <= 0 || (selectedCount == maxCount && candidate.Score <= selected[selectedCount - 1].Score))
+		{
+			return;
+		}
+
+		int position = glm::min(selectedCount, maxCount - 1);
+
+		while (position > 0 && selected[position - 1].Score < candidate.Score)
+		{
+			selected[position] = selected[position - 1];
+			position--;
+		}
+
+		selected[position] = candidate;
+		selectedCount = glm::min(selectedCount + 1, maxCount);
+	}
+
+	// Rebuilds the lights of one type when the list changed and uploads the filled part of its
+	// block array. Returns false when nothing changed.
+	template <typename T, typename TData>
+	bool Pack(const GLLightList<T>& lights, std::vector<TData>& data, int& count, TData* blockData, GLintptr offset, uint64_t& packedVersion)
+	{
+		uint64_t version = lights.GetVersion();
+
+		if (version == packedVersion)
+		{
+			return false;
+		}
+
+		packedVersion = version;
+		data.clear();
+
+		for (const auto& light : lights.Get())
+		{
+			if (light->GetActive())
+			{
+				data.emplace_back();
+				light->Write(data.back());
+			}
+		}
+
+		count = glm::min((int)data.size(), GLMaterialShader::MAX_LIGHT_COUNT);
+		std::copy(data.begin(), data.begin() + count, blockData);
+
+		this->block.Counts.w = (int)this->pointData.size();
+
+		// Only the filled part of the array is uploaded.
+		this->Upload(blockData, count * sizeof(TData), offset);
+		this->Upload(&this->block.Counts, sizeof(this->block.Counts), offsetof(GLLightBlock, Counts));
+
+		this->packCount++;
+
+		return true;
+	}
+
+	template <typename TData>
+	static void UpdateInfluences(const std::vector<TData>& data, std::vector<GLLightInfluence>& influences)
+	{
+		influences.resize(data.size());
+
+		for (size_t i = 0; i < data.size(); ++i)
+		{
+			UpdateInfluence(data[i], influences[i]);
+		}
+	}
+
+	static void UpdateInfluence(const GLPointLightData& data, GLLightInfluence& influence)
+	{
+		influence.Position = glm::vec3(data.Position);
+		influence.Attenuation = glm::vec3(data.Position.w, data.Ambient.w, data.Diffuse.w);
+		influence.Intensity = GetIntensity(data.Ambient, data.Diffuse);
+		influence.Range = GetRange(influence.Attenuation, influence.Intensity);
+	}
+
+	static void UpdateInfluence(const GLSpotLightData& data, GLLightInfluence& influence)
+	{
+		influence.Position = glm::vec3(data.Position);
+		influence.Attenuation = glm::vec3(data.Position.w, data.Ambient.w, data.Diffuse.w);
+		influence.Intensity = GetIntensity(data.Ambient, data.Diffuse);
+		influence.Range = GetRange(influence.Attenuation, influence.Intensity);
+
+		glm::vec3 direction = glm::vec3(data.Direction);
+		float length = glm::length(direction);
+
+		influence.Direction = length > 0.0f ? direction / length : glm::vec3(0.0f, -1.0f, 0.0f);
+		influence.CosOuterCutOff = glm::clamp(data.Specular.w, -1.0f, 1.0f);
+		influence.SinOuterCutOff = glm::sqrt(1.0f - influence.CosOuterCutOff * influence.CosOuterCutOff);
+	}
+
+	static float GetIntensity(const glm::vec4& ambient, const glm::vec4& diffuse)
+	{
+		return glm::max(ambient.x + diffuse.x, glm::max(ambient.y + diffuse.y, ambient.z + diffuse.z));
+	}
+
+	// Distance at which intensity / (constant + linear * d + quadratic * d^2) drops below the threshold.
+	static float GetRange(const glm::vec3& attenuation, float intensity)
+	{
+		float limit = intensity / influenceThreshold;
+
+		float constant = attenuation.x - limit;
+		float linear = attenuation.y;
+		float quadratic = attenuation.z;
+
+		if (constant >= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		if (quadratic > 0.0f)
+		{
+			return (-linear + glm::sqrt(linear * linear - 4.0f * quadratic * constant)) / (2.0f * quadratic);
+		}
+
+		if (linear > 0.0f)
+		{
+			return -constant / linear;
+		}
+
+		return std::numeric_limits<float>::max();
+	}
+
+	// Light intensity at the point of the sphere closest to the light, zero outside its influence.
+	static float GetScore(const GLLightInfluence& influence, const glm::vec3& center, float radius)
+	{
+		glm::vec3 offset = center - influence.Position;
+
+		float distance = glm::length(offset);
+		float reach = influence.Range + radius;
+
+		if (distance >= reach)
+		{
+			return 0.0f;
+		}
+
+		if (influence.CosOuterCutOff > -1.0f && distance > radius)
+		{
+			// Sphere against cone: outside when its center is further than radius from the cone surface.
+			float along = glm::dot(offset, influence.Direction);
+			float across = glm::sqrt(glm::max(distance * distance - along * along, 0.0f));
+
+			if (influence.CosOuterCutOff * across - influence.SinOuterCutOff * along > radius)
+			{
+				return 0.0f;
+			}
+		}
+
+		float nearest = glm::max(distance - radius, 0.0f);
+		const glm::vec3& attenuation = influence.Attenuation;
+
+		return influence.Intensity / glm::max(attenuation.x + attenuation.y * nearest + attenuation.z * nearest * nearest, 1e-4f);
+	}
+
+	void Upload(const void* data, GLsizeiptr size, GLintptr offset)
+	{
+		if (size > 0)
+		{
+			this->uniformBuffer->Update(data, size, offset);
+		}
+	}
+
+	GLLightBlock block;
+
+	uint64_t directionalVersion = UINT64_MAX;
+	uint64_t pointVersion = UINT64_MAX;
+	uint64_t spotVersion = UINT64_MAX;
+
+	size_t packCount = 0;
+
+	std::vector<GLDirectionalLightData> directionalData;
+	std::vector<GLPointLightData> pointData;
+	std::vector<GLSpotLightData> spotData;
+
+	std::vector<GLLightInfluence> pointInfluences;
+	std::vector<GLLightInfluence> spotInfluences;
+
+	std::vector<glm::vec4> texels;
+	bool bLightDataDirty = true;
+
+	static float influenceThreshold;
+
+	GLSharedPtr<GLUniformBuffer> uniformBuffer = nullptr;
+	GLSharedPtr<GLTextureBuffer> lightData = nullptr;
+};
+
+float GLLightBuffer::influenceThreshold = 1.0f / 256.0f;
\ No newline at end of file
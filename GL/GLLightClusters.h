@@ -0,0 +1,535 @@
+#pragma once
+
+#include <cstring>
+#include <atomic>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define GL_LIGHT_CLUSTERS_SSE
+#endif
+
+#include <gl/glew.h>
+#include <gl/glm/glm.hpp>
+
+#include "GLMemoryHelpers.h"
+#include "GLJobSystem.h"
+#include "GLLightBuffer.h"
+#include "GLTextureBuffer.h"
+
+struct GLLightClusterStats
+{
+	size_t Assignments = 0;
+	size_t Overflows = 0;
+	size_t Rebuilds = 0;
+};
+
+// Froxel grid over the view frustum of one camera. Every frame the point and spot lights are
+// assigned to the clusters they reach, and per cluster the offset and counts of its light
+// indices are uploaded for clustered material variants.
+//
+// Tiles split the viewport evenly, depth slices are logarithmic for perspective cameras and
+// linear for orthographic ones. Bounds are kept in view space with depth pointing forward.
+class GLLightClusters
+{
+public:
+	static const int TILE_COUNT_X = 16;
+	static const int TILE_COUNT_Y = 9;
+	static const int SLICE_COUNT = 24;
+	static const int CLUSTER_COUNT = TILE_COUNT_X * TILE_COUNT_Y * SLICE_COUNT;
+
+	// Lights past this many in one cluster are dropped and counted as overflows.
+	static const int MAX_LIGHTS_PER_CLUSTER = 128;
+
+	GLLightClusters()
+	{
+		this->clusterRanges = GLCreate<GLTextureBuffer>(GL_RGBA32I, CLUSTER_COUNT * sizeof(glm::tvec4<int>));
+		this->clusterLightIndices = GLCreate<GLTextureBuffer>(GL_R32I);
+
+		this->bounds.resize(CLUSTER_COUNT);
+		this->rowBounds.resize(TILE_COUNT_Y * SLICE_COUNT);
+
+		this->ranges.resize(CLUSTER_COUNT);
+		this->pointCounts.resize(CLUSTER_COUNT);
+		this->spotCounts.resize(CLUSTER_COUNT);
+		this->slots.resize(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+	}
+
+	virtual ~GLLightClusters() { }
+
+	// Rebuilds the cluster bounds when the projection changed and assigns every light.
+	void Update(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const GLLightBuffer& lights)
+	{
+		if (std::memcmp(&projectionMatrix, &this->projectionMatrix, sizeof(glm::mat4)) != 0)
+		{
+			this->projectionMatrix = projectionMatrix;
+			this->BuildBounds();
+
+			this->stats.Rebuilds++;
+		}
+
+		this->TransformLights(viewMatrix, lights);
+
+		std::atomic<size_t> overflows(0);
+
+		// One job per row of tiles in a slice, lights are first culled against the whole row.
+		GLJobSystem::ParallelFor(TILE_COUNT_Y * SLICE_COUNT, 4,
+			[this, &overflows](int begin, int end, int worker)
+			{
+				size_t dropped = 0;
+
+				for (int row = begin; row < end; ++row)
+				{
+					dropped += this->AssignRow(row, worker);
+				}
+
+				overflows += dropped;
+			}
+		);
+
+		this->Compact();
+
+		this->stats.Overflows += overflows;
+	}
+
+	void Bind()
+	{
+		this->clusterRanges->Bind((int)GLTextureUnit::ClusterRanges);
+		this->clusterLightIndices->Bind((int)GLTextureUnit::ClusterLightIndices);
+	}
+
+	// Depth slice scale and bias, see the Camera block.
+	glm::vec4 GetParams()
+	{
+		return glm::vec4(this->sliceScale, this->sliceBias, 0.0f, 0.0f);
+	}
+
+	// Tile counts, slice count and whether slices are logarithmic.
+	glm::tvec4<int> GetGrid()
+	{
+		return glm::tvec4<int>(TILE_COUNT_X, TILE_COUNT_Y, SLICE_COUNT, this->bPerspective ? 1 : 0);
+	}
+
+	GLLightClusterStats GetStats()
+	{
+		return this->stats;
+	}
+
+	void ResetStats()
+	{
+		this->stats = GLLightClusterStats();
+	}
+
+private:
+	struct Bounds
+	{
+		glm::vec3 Min;
+		glm::vec3 Max;
+	};
+
+	// Light spheres as structure of arrays, padded to a multiple of four with spheres that never hit.
+	struct Spheres
+	{
+		std::vector<float> X;
+		std::vector<float> Y;
+		std::vector<float> Z;
+		std::vector<float> Radius;
+		std::vector<int> Index;
+
+		void Clear()
+		{
+			this->X.clear();
+			this->Y.clear();
+			this->Z.clear();
+			this->Radius.clear();
+			this->Index.clear();
+		}
+
+		void Add(const glm::vec3& center, float radius, int index)
+		{
+			this->X.push_back(center.x);
+			this->Y.push_back(center.y);
+			this->Z.push_back(center.z);
+			this->Radius.push_back(radius);
+			this->Index.push_back(index);
+		}
+
+		void Pad()
+		{
+			while (this->X.size() % 4 != 0)
+			{
+				this->Add(glm::vec3(1e30f), 0.0f, -1);
+			}
+		}
+
+		int GetCount() const
+		{
+			return (int)this->X.size();
+		}
+	};
+
+	// View space cone of a spot light.
+	struct Cone
+	{
+		glm::vec3 Position;
+		glm::vec3 Direction;
+		float CosOuterCutOff;
+		float SinOuterCutOff;
+	};
+
+	struct WorkerScratch
+	{
+		Spheres Points;
+		Spheres Spots;
+		int Hits[MAX_LIGHTS_PER_CLUSTER];
+	};
+
+	// View space AABBs of every cluster and every row of tiles.
+	void BuildBounds()
+	{
+		const glm::mat4& projection = this->projectionMatrix;
+
+		this->bPerspective = projection[3][3] != 1.0f;
+
+		float nearDepth;
+		float farDepth;
+
+		if (this->bPerspective)
+		{
+			nearDepth = projection[3][2] / (projection[2][2] - 1.0f);
+			farDepth = projection[3][2] / (projection[2][2] + 1.0f);
+
+			this->sliceScale = SLICE_COUNT / glm::log(farDepth / nearDepth);
+			this->sliceBias = -glm::log(nearDepth) * this->sliceScale;
+		}
+		else
+		{
+			nearDepth = (projection[3][2] + 1.0f) / projection[2][2];
+			farDepth = (projection[3][2] - 1.0f) / projection[2][2];
+
+			this->sliceScale = SLICE_COUNT / (farDepth - nearDepth);
+			this->sliceBias = -nearDepth * this->sliceScale;
+		}
+
+		for (int slice = 0; slice < SLICE_COUNT; ++slice)
+		{
+			float depths[2] = { this->GetSliceDepth(slice, nearDepth, farDepth), this->GetSliceDepth(slice + 1, nearDepth, farDepth) };
+
+			for (int y = 0; y < TILE_COUNT_Y; ++y)
+			{
+				Bounds& row = this->rowBounds[slice * TILE_COUNT_Y + y];
+				row.Min = glm::vec3(std::numeric_limits<float>::max());
+				row.Max = glm::vec3(-std::numeric_limits<float>::max());
+
+				for (int x = 0; x < TILE_COUNT_X; ++x)
+				{
+					Bounds& cluster = this->bounds[(slice * TILE_COUNT_Y + y) * TILE_COUNT_X + x];
+					cluster.Min = glm::vec3(std::numeric_limits<float>::max());
+					cluster.Max = glm::vec3(-std::numeric_limits<float>::max());
+
+					for (int corner = 0; corner < 8; ++corner)
+					{
+						glm::vec2 ndc(-1.0f + 2.0f * (x + (corner & 1)) / TILE_COUNT_X, -1.0f + 2.0f * (y + ((corner >> 1) & 1)) / TILE_COUNT_Y);
+						glm::vec3 point = this->Unproject(ndc, depths[corner >> 2]);
+
+						cluster.Min = glm::min(cluster.Min, point);
+						cluster.Max = glm::max(cluster.Max, point);
+					}
+
+					row.Min = glm::min(row.Min, cluster.Min);
+					row.Max = glm::max(row.Max, cluster.Max);
+				}
+			}
+		}
+	}
+
+	float GetSliceDepth(int slice, float nearDepth, float farDepth)
+	{
+		float t = (float)slice / SLICE_COUNT;
+
+		return this->bPerspective ? nearDepth * glm::pow(farDepth / nearDepth, t) : nearDepth + (farDepth - nearDepth) * t;
+	}
+
+	// View space point on the given depth in front of the camera.
+	glm::vec3 Unproject(const glm::vec2& ndc, float depth)
+	{
+		const glm::mat4& projection = this->projectionMatrix;
+
+		if (this->bPerspective)
+		{
+			return glm::vec3(depth * (ndc.x + projection[2][0]) / projection[0][0], depth * (ndc.y + projection[2][1]) / projection[1][1], depth);
+		}
+
+		return glm::vec3((ndc.x - projection[3][0]) / projection[0][0], (ndc.y - projection[3][1]) / projection[1][1], depth);
+	}
+
+	void TransformLights(const glm::mat4& viewMatrix, const GLLightBuffer& lights)
+	{
+		this->points.Clear();
+		this->spots.Clear();
+		this->cones.resize(lights.GetTotalSpotCount());
+
+		for (int i = 0; i < lights.GetTotalPointCount(); ++i)
+		{
+			const GLLightInfluence& influence = lights.GetPointInfluence(i);
+
+			if (influence.Range > 0.0f)
+			{
+				this->points.Add(this->ToView(viewMatrix, influence.Position, 1.0f), influence.Range, i);
+			}
+		}
+
+		for (int i = 0; i < lights.GetTotalSpotCount(); ++i)
+		{
+			const GLLightInfluence& influence = lights.GetSpotInfluence(i);
+
+			if (influence.Range > 0.0f)
+			{
+				Cone& cone = this->cones[i];
+				cone.Position = this->ToView(viewMatrix, influence.Position, 1.0f);
+				cone.Direction = this->ToView(viewMatrix, influence.Direction, 0.0f);
+				cone.CosOuterCutOff = influence.CosOuterCutOff;
+				cone.SinOuterCutOff = influence.SinOuterCutOff;
+
+				this->spots.Add(cone.Position, influence.Range, i);
+			}
+		}
+
+		this->points.Pad();
+		this->spots.Pad();
+
+		int threadCount = GLJobSystem::GetThreadCount();
+
+		if ((int)this->scratch.size() < threadCount)
+		{
+			this->scratch.resize(threadCount);
+		}
+	}
+
+	glm::vec3 ToView(const glm::mat4& viewMatrix, const glm::vec3& vector, float w)
+	{
+		glm::vec4 view = viewMatrix * glm::vec4(vector, w);
+
+		return glm::vec3(view.x, view.y, -view.z);
+	}
+
+	// Assigns the lights of one row of tiles, returns the number of lights dropped.
+	size_t AssignRow(int row, int worker)
+	{
+		WorkerScratch& scratch = this->scratch[worker];
+
+		const Bounds& rowBounds = this->rowBounds[row];
+
+		this->Gather(this->points, rowBounds, scratch.Points);
+		this->Gather(this->spots, rowBounds, scratch.Spots);
+
+		size_t dropped = 0;
+
+		for (int x = 0; x < TILE_COUNT_X; ++x)
+		{
+			int cluster = row * TILE_COUNT_X + x;
+			const Bounds& bounds = this->bounds[cluster];
+
+			int* slots = &this->slots[cluster * MAX_LIGHTS_PER_CLUSTER];
+
+			int pointCount = this->Intersect(scratch.Points, bounds, scratch.Hits);
+			int storedPoints = glm::min(pointCount, MAX_LIGHTS_PER_CLUSTER);
+
+			std::memcpy(slots, scratch.Hits, storedPoints * sizeof(int));
+
+			int spotCount = this->Intersect(scratch.Spots, bounds, scratch.Hits);
+			int testedSpots = glm::min(spotCount, MAX_LIGHTS_PER_CLUSTER);
+			int storedSpots = 0;
+
+			glm::vec3 center = (bounds.Min + bounds.Max) * 0.5f;
+			float radius = glm::length(bounds.Max - center);
+
+			for (int i = 0; i < testedSpots; ++i)
+			{
+				if (!this->IntersectCone(this->cones[scratch.Hits[i]], center, radius))
+				{
+					continue;
+				}
+
+				if (storedPoints + storedSpots < MAX_LIGHTS_PER_CLUSTER)
+				{
+					slots[storedPoints + storedSpots++] = scratch.Hits[i];
+				}
+				else
+				{
+					dropped++;
+				}
+			}
+
+			dropped += pointCount - storedPoints + spotCount - testedSpots;
+
+			this->pointCounts[cluster] = storedPoints;
+			this->spotCounts[cluster] = storedSpots;
+		}
+
+		return dropped;
+	}
+
+	// Copies the spheres touching the bounds.
+	void Gather(const Spheres& spheres, const Bounds& bounds, Spheres& gathered)
+	{
+		gathered.Clear();
+
+		for (int i = 0; i < spheres.GetCount(); i += 4)
+		{
+			int mask = this->Intersect4(spheres, i, bounds);
+
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				if (mask & (1 << lane))
+				{
+					int hit = i + lane;
+					gathered.Add(glm::vec3(spheres.X[hit], spheres.Y[hit], spheres.Z[hit]), spheres.Radius[hit], spheres.Index[hit]);
+				}
+			}
+		}
+
+		gathered.Pad();
+	}
+
+	// Writes the light indices of the spheres touching the bounds, returns how many there are.
+	// Hits beyond MAX_LIGHTS_PER_CLUSTER are counted but not written.
+	int Intersect(const Spheres& spheres, const Bounds& bounds, int* hits)
+	{
+		int count = 0;
+
+		for (int i = 0; i < spheres.GetCount(); i += 4)
+		{
+			int mask = this->Intersect4(spheres, i, bounds);
+
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				if (mask & (1 << lane))
+				{
+					if (count < MAX_LIGHTS_PER_CLUSTER)
+					{
+						hits[count] = spheres.Index[i + lane];
+					}
+
+					count++;
+				}
+			}
+		}
+
+		return count;
+	}
+
+	// Sphere against AABB for four spheres at once, bit n is set when sphere first + n touches.
+	int Intersect4(const Spheres& spheres, int first, const Bounds& bounds)
+	{
+#if defined(GL_LIGHT_CLUSTERS_SSE)
+		const __m128 zero = _mm_setzero_ps();
+
+		__m128 x = _mm_loadu_ps(&spheres.X[first]);
+		__m128 y = _mm_loadu_ps(&spheres.Y[first]);
+		__m128 z = _mm_loadu_ps(&spheres.Z[first]);
+		__m128 radius = _mm_loadu_ps(&spheres.Radius[first]);
+
+		// Distance to the box along each axis, zero inside its extent.
+		__m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(bounds.Min.x), x), zero), _mm_max_ps(_mm_sub_ps(x, _mm_set1_ps(bounds.Max.x)), zero));
+		__m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(bounds.Min.y), y), zero), _mm_max_ps(_mm_sub_ps(y, _mm_set1_ps(bounds.Max.y)), zero));
+		__m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(bounds.Min.z), z), zero), _mm_max_ps(_mm_sub_ps(z, _mm_set1_ps(bounds.Max.z)), zero));
+
+		__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		return _mm_movemask_ps(_mm_cmple_ps(distance, _mm_mul_ps(radius, radius)));
+#else
+		int mask = 0;
+
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			glm::vec3 center(spheres.X[first + lane], spheres.Y[first + lane], spheres.Z[first + lane]);
+			glm::vec3 offset = glm::max(bounds.Min - center, glm::vec3(0.0f)) + glm::max(center - bounds.Max, glm::vec3(0.0f));
+
+			float radius = spheres.Radius[first + lane];
+
+			if (glm::dot(offset, offset) <= radius * radius)
+			{
+				mask |= 1 << lane;
+			}
+		}
+
+		return mask;
+#endif
+	}
+
+	// Cone of a spot light against the bounding sphere of a cluster, as GLLightBuffer::GetScore.
+	bool IntersectCone(const Cone& cone, const glm::vec3& center, float radius)
+	{
+		if (cone.CosOuterCutOff <= -1.0f)
+		{
+			return true;
+		}
+
+		glm::vec3 offset = center - cone.Position;
+
+		float distance = glm::length(offset);
+
+		if (distance <= radius)
+		{
+			return true;
+		}
+
+		float along = glm::dot(offset, cone.Direction);
+		float across = glm::sqrt(glm::max(distance * distance - along * along, 0.0f));
+
+		return cone.CosOuterCutOff * across - cone.SinOuterCutOff * along <= radius;
+	}
+
+	// Packs the per cluster slots into one index list and uploads it with the ranges.
+	void Compact()
+	{
+		this->indices.clear();
+
+		size_t assignments = 0;
+
+		for (int cluster = 0; cluster < CLUSTER_COUNT; ++cluster)
+		{
+			int count = this->pointCounts[cluster] + this->spotCounts[cluster];
+			const int* slots = &this->slots[cluster * MAX_LIGHTS_PER_CLUSTER];
+
+			this->ranges[cluster] = glm::tvec4<int>((int)this->indices.size(), this->pointCounts[cluster], this->spotCounts[cluster], 0);
+			this->indices.insert(this->indices.end(), slots, slots + count);
+
+			assignments += count;
+		}
+
+		this->clusterRanges->Update(this->ranges.data(), this->ranges.size() * sizeof(glm::tvec4<int>));
+		this->clusterLightIndices->Update(this->indices.data(), this->indices.size() * sizeof(int));
+
+		this->stats.Assignments += assignments;
+	}
+
+	glm::mat4 projectionMatrix = glm::mat4(0.0f);
+	bool bPerspective = true;
+
+	float sliceScale = 0.0f;
+	float sliceBias = 0.0f;
+
+	std::vector<Bounds> bounds;
+	std::vector<Bounds> rowBounds;
+
+	Spheres points;
+	Spheres spots;
+	std::vector<Cone> cones;
+
+	std::vector<WorkerScratch> scratch;
+
+	std::vector<int> pointCounts;
+	std::vector<int> spotCounts;
+	std::vector<int> slots;
+
+	std::vector<glm::tvec4<int>> ranges;
+	std::vector<int> indices;
+
+	GLLightClusterStats stats;
+
+	GLSharedPtr<GLTextureBuffer> clusterRanges = nullptr;
+	GLSharedPtr<GLTextureBuffer> clusterLightIndices = nullptr;
+};
\ No newline at end of file
@@ -11,6 +11,8 @@
 #include "core/Singleton.h"
 #include "GLMemoryHelpers.h"
 #include "GLScene.h"
+#include "GLTextureLoader.h"
+#include "GLShaderRegistry.h"
 #include "GLWindow.h"
 #include "GLKeyMapper.h"
 
@@ -169,6 +171,17 @@ void __GLUpdateScene()
 	scene->Update(deltaTime);
 	scene->Render(window->GetSize());
 
+	GLTextureLoader::UpdateStreaming();
+	GLShaderRegistry::PollPending();
+
+	// Every material has requested its program by the end of the first frame.
+	static bool bShaderReported = false;
+	if (!bShaderReported)
+	{
+		bShaderReported = true;
+		GLShaderRegistry::Report();
+	}
+
 	float finishedTime = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
 	float elapsedTime = finishedTime - currentTime;
 	std::this_thread::sleep_for(std::chrono::milliseconds((int)glm::max(0.0f, 1000 / 60 - elapsedTime)));
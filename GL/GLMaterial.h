@@ -10,6 +10,8 @@
 #include "GLShader.h"
 #include "GLBasicShader.h"
 #include "GLTexture.h"
+#include "GLTextureArray.h"
+#include "GLSampler.h"
 
 
 
@@ -18,13 +20,11 @@ class GLMaterial
 public:
 	GLMaterial()
 	{
-		this->shader = GLCreate<GLBasicMaterialShader>();
+
 	}
 
 	GLMaterial(const glm::vec3& ambient, const glm::vec3& diffuse, const glm::vec3& specular, float shininess)
 	{
-		this->shader = GLCreate<GLBasicMaterialShader>();
-
 		this->ambient = ambient;
 		this->diffuse = diffuse;
 		this->specular = specular;
@@ -76,14 +76,156 @@ public:
 		this->shininess = shininess;
 	}
 
-	GLSharedPtr<GLShader> GetShader()
+	const GLSharedPtr<GLShader>& GetShader()
 	{
+		if (this->shader == nullptr)
+		{
+			this->shader = GLMaterialShader::Get(GLMaterialShader::GetDefines(this->GetDiffuseSource()));
+			this->variantKey = -1;
+		}
+
 		return this->shader;
 	}
 
+	// A custom shader is used as is, no variants are selected for it.
 	void SetShader(const GLSharedPtr<GLShader>& shader)
 	{
 		this->shader = shader;
+		this->bCustomShader = shader != nullptr;
+	}
+
+	GLDiffuseSource GetDiffuseSource()
+	{
+		if (this->diffuseMap != nullptr)
+		{
+			return GLDiffuseSource::Map;
+		}
+
+		if (this->diffuseMapLayer.Array != nullptr)
+		{
+			return GLDiffuseSource::MapArray;
+		}
+
+		return GLDiffuseSource::Color;
+	}
+
+	// Switches to the built-in variant compiled for exactly these light counts.
+	void SelectVariant(int directionalCount, int pointCount, int spotCount)
+	{
+		if (this->bCustomShader)
+		{
+			return;
+		}
+
+		directionalCount = glm::min(directionalCount, GLMaterialShader::MAX_LIGHT_COUNT);
+		pointCount = glm::min(pointCount, GLMaterialShader::MAX_LIGHT_COUNT);
+		spotCount = glm::min(spotCount, GLMaterialShader::MAX_LIGHT_COUNT);
+
+		int diffuseSource = (int)this->GetDiffuseSource();
+		int key = ((directionalCount * 32 + pointCount) * 32 + spotCount) * 4 + diffuseSource;
+
+		if (key == this->variantKey && this->shader != nullptr)
+		{
+			return;
+		}
+
+		this->shader = GLMaterialShader::Get(GLMaterialShader::GetDefines(this->GetDiffuseSource(), directionalCount, pointCount, spotCount));
+		this->variantKey = key;
+	}
+
+	// Light list variants are keyed below -1, apart from the light count variants.
+	void SelectLightListVariant(int listSize)
+	{
+		if (this->bCustomShader)
+		{
+			return;
+		}
+
+		int key = -2 - (listSize * 4 + (int)this->GetDiffuseSource());
+
+		if (key == this->variantKey && this->shader != nullptr)
+		{
+			return;
+		}
+
+		this->shader = GLMaterialShader::Get(GLMaterialShader::GetLightListDefines(this->GetDiffuseSource(), listSize));
+		this->variantKey = key;
+	}
+
+	// Clustered variants are keyed below the light list variants.
+	void SelectClusteredVariant()
+	{
+		if (this->bCustomShader)
+		{
+			return;
+		}
+
+		int key = -2 - ((GLMaterialShader::MAX_LIGHT_COUNT + 1) * 4 + (int)this->GetDiffuseSource());
+
+		if (key == this->variantKey && this->shader != nullptr)
+		{
+			return;
+		}
+
+		this->shader = GLMaterialShader::Get(GLMaterialShader::GetClusteredDefines(this->GetDiffuseSource()));
+		this->variantKey = key;
+	}
+
+	// G-buffer variants are keyed below the clustered variants.
+	void SelectGBufferVariant()
+	{
+		if (this->bCustomShader)
+		{
+			return;
+		}
+
+		int key = -2 - ((GLMaterialShader::MAX_LIGHT_COUNT + 2) * 4 + (int)this->GetDiffuseSource());
+
+		if (key == this->variantKey && this->shader != nullptr)
+		{
+			return;
+		}
+
+		this->shader = GLMaterialShader::Get(GLMaterialShader::GetGBufferDefines(this->GetDiffuseSource()));
+		this->variantKey = key;
+	}
+
+	bool HasCustomShader()
+	{
+		return this->bCustomShader;
+	}
+
+	// Small id unique to the material, render queue keys group draws of the same material with it.
+	unsigned int GetSortId()
+	{
+		return this->sortId;
+	}
+
+	// Texture bound by Use, 0 without a diffuse map.
+	unsigned int GetTextureId()
+	{
+		if (this->diffuseMap != nullptr)
+		{
+			return this->diffuseMap->GetId();
+		}
+
+		if (this->diffuseMapLayer.Array != nullptr)
+		{
+			return this->diffuseMapLayer.Array->GetId();
+		}
+
+		return 0;
+	}
+
+	// Sampler bound with the diffuse map, 0 without one. Equal sampler descriptions share the sampler.
+	unsigned int GetSamplerId()
+	{
+		if (this->diffuseMap == nullptr && this->diffuseMapLayer.Array == nullptr)
+		{
+			return 0;
+		}
+
+		return this->GetSampler()->GetId();
 	}
 
 	GLSharedPtr<GLTexture> GetDiffuseMap()
@@ -93,66 +235,164 @@ public:
 
 	void SetDiffuseMap(const GLSharedPtr<GLTexture>& diffuseMap)
 	{
-		if (this->diffuseMap == nullptr && diffuseMap != nullptr)
+		if ((this->diffuseMap == nullptr) != (diffuseMap == nullptr) || this->diffuseMapLayer.Array != nullptr)
 		{
-			this->shader = GLCreate<GLBasicTextureMaterialShader>();
+			this->ResetShader();
 		}
-		else if (diffuseMap == nullptr)
+
+		this->diffuseMap = diffuseMap;
+		this->diffuseMapLayer = GLTextureLayer();
+	}
+
+	const GLSamplerDesc& GetSamplerDesc()
+	{
+		return this->samplerDesc;
+	}
+
+	// Filtering and wrapping of the diffuse map, e.g. GLSamplerDesc::Bilinear() for cheaper sampling.
+	void SetSamplerDesc(const GLSamplerDesc& samplerDesc)
+	{
+		this->samplerDesc = samplerDesc;
+		this->sampler = nullptr;
+	}
+
+	const GLTextureLayer& GetDiffuseMapLayer()
+	{
+		return this->diffuseMapLayer;
+	}
+
+	// References a layer of a shared texture array instead of a texture of its own.
+	// Materials using layers of the same array keep the same texture binding.
+	void SetDiffuseMapLayer(const GLTextureLayer& diffuseMapLayer)
+	{
+		if ((this->diffuseMapLayer.Array == nullptr) != (diffuseMapLayer.Array == nullptr) || this->diffuseMap != nullptr)
 		{
-			this->shader = GLCreate<GLBasicMaterialShader>();
+			this->ResetShader();
 		}
 
-		this->diffuseMap = diffuseMap;
+		this->diffuseMap = nullptr;
+		this->diffuseMapLayer = diffuseMapLayer;
+	}
+
+	// Forwards the on-screen size of an object using this material to the diffuse map streaming.
+	void RequestDetail(float screenSize)
+	{
+		if (this->diffuseMap != nullptr)
+		{
+			this->diffuseMap->RequestScreenSize(screenSize);
+		}
 	}
 
 	void Use()
 	{
-		this->shader->Use();
+		auto& shader = this->GetShader();
 
-		int ambientUniform = this->shader->GetUniformLocation("material.ambient");
-		int diffuseUniform = this->shader->GetUniformLocation("material.diffuse");
-		int specularUniform = this->shader->GetUniformLocation("material.specular");
-		int shininessUniform = this->shader->GetUniformLocation("material.shininess");
+		shader->Use();
 
 		if (this->diffuseMap != nullptr)
 		{
-			this->shader->SetUniform("material.diffuse", 0);
-			this->diffuseMap->Use();
+			shader->SetUniform(diffuseMapUniform, 0);
+			this->diffuseMap->Use(0);
+			this->GetSampler()->Use(0);
+		}
+		else if (this->diffuseMapLayer.Array != nullptr)
+		{
+			shader->SetUniform(diffuseMapUniform, 0);
+			shader->SetUniform(diffuseLayerUniform, this->diffuseMapLayer.Layer);
+			this->diffuseMapLayer.Array->Use(0);
+			this->GetSampler()->Use(0);
 		}
 		else
 		{
-			if (ambientUniform > 0)
-			{
-				this->shader->SetUniform(ambientUniform, this->ambient);
-			}
-
-			if (diffuseUniform > 0)
-			{
-				this->shader->SetUniform(diffuseUniform, this->diffuse);
-			}
+			shader->SetUniform(ambientUniform, this->ambient);
+			shader->SetUniform(diffuseUniform, this->diffuse);
 		}
 
-		if (specularUniform > 0)
+		shader->SetUniform(specularUniform, this->specular);
+		shader->SetUniform(shininessUniform, this->shininess);
+	}
+
+	// Binds the diffuse map for an instanced draw with shader, the colors come from the instances.
+	void UseInstanced(const GLSharedPtr<GLShader>& shader)
+	{
+		shader->Use();
+
+		if (this->diffuseMap != nullptr)
 		{
-			this->shader->SetUniform(specularUniform, this->specular);
+			shader->SetUniform(diffuseMapUniform, 0);
+			this->diffuseMap->Use(0);
+			this->GetSampler()->Use(0);
 		}
-
-		if (shininessUniform > 0)
+		else if (this->diffuseMapLayer.Array != nullptr)
 		{
-			this->shader->SetUniform(shininessUniform, this->shininess);
+			shader->SetUniform(diffuseMapUniform, 0);
+			this->diffuseMapLayer.Array->Use(0);
+			this->GetSampler()->Use(0);
 		}
 	}
 
+	// Colors of this material for one instance, see GLInstanceData.
+	void GetInstanceColors(glm::vec4& diffuse, glm::vec4& specular)
+	{
+		diffuse = glm::vec4(this->diffuse, (float)this->diffuseMapLayer.Layer);
+		specular = glm::vec4(this->specular, this->shininess);
+	}
+
 private:
+	// The diffuse source is part of the variant, so the next GetShader or SelectVariant picks a new one.
+	void ResetShader()
+	{
+		this->shader = nullptr;
+		this->bCustomShader = false;
+		this->variantKey = -1;
+	}
+
+	const GLSharedPtr<GLSampler>& GetSampler()
+	{
+		if (this->sampler == nullptr)
+		{
+			this->sampler = GLSamplerCache::Get(this->samplerDesc);
+		}
+
+		return this->sampler;
+	}
+
 	glm::vec3 ambient = glm::vec3(1.0f);
 	glm::vec3 diffuse = glm::vec3(1.0f);
 	glm::vec3 specular = glm::vec3(1.0f);
 	float shininess = 0.0f;
 
 	GLSharedPtr<GLShader> shader = nullptr;
+	bool bCustomShader = false;
+	int variantKey = -1;
+
+	unsigned int sortId = nextSortId++;
+
 	GLSharedPtr<GLTexture> diffuseMap = nullptr;
+	GLTextureLayer diffuseMapLayer;
+
+	GLSamplerDesc samplerDesc;
+	GLSharedPtr<GLSampler> sampler = nullptr;
+
+	static const GLUniformHandle<glm::vec3> ambientUniform;
+	static const GLUniformHandle<glm::vec3> diffuseUniform;
+	static const GLUniformHandle<int> diffuseMapUniform;
+	static const GLUniformHandle<int> diffuseLayerUniform;
+	static const GLUniformHandle<glm::vec3> specularUniform;
+	static const GLUniformHandle<float> shininessUniform;
+
+	static unsigned int nextSortId;
 };
 
+unsigned int GLMaterial::nextSortId = 0;
+
+const GLUniformHandle<glm::vec3> GLMaterial::ambientUniform(GLHashName("material.ambient"));
+const GLUniformHandle<glm::vec3> GLMaterial::diffuseUniform(GLHashName("material.diffuse"));
+const GLUniformHandle<int> GLMaterial::diffuseMapUniform(GLHashName("material.diffuse"));
+const GLUniformHandle<int> GLMaterial::diffuseLayerUniform(GLHashName("material.diffuseLayer"));
+const GLUniformHandle<glm::vec3> GLMaterial::specularUniform(GLHashName("material.specular"));
+const GLUniformHandle<float> GLMaterial::shininessUniform(GLHashName("material.shininess"));
+
 std::unordered_map<std::string, GLSharedPtr<GLMaterial>> __GLPredefinedMaterials;
 
 GLSharedPtr<GLMaterial> GLGetPreDefinedMaterial(const std::string& materialType)
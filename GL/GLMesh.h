@@ -1,9 +1,25 @@
 #pragma once
 
+#include <atomic>
+#include <mutex>
+#include <vector>
+
 #include <gl/glew.h>
+#include <gl/glm/glm.hpp>
 
 #include "GLMemoryHelpers.h"
 #include "GLColor.h"
+#include "GLInstanceBuffer.h"
+#include "GLStateCache.h"
+
+struct GLBounds
+{
+	glm::vec3 Min = glm::vec3(0.0f);
+	glm::vec3 Max = glm::vec3(0.0f);
+
+	glm::vec3 Center = glm::vec3(0.0f);
+	float Radius = 0.0f;
+};
 
 enum class GLMeshDrawMode
 {
@@ -31,6 +47,7 @@ public:
 	GLMesh()
 	{
 		glGenVertexArrays(1, &this->vertexArrayId);
+		glGenVertexArrays(1, &this->positionArrayId);
 
 		glGenBuffers(1, &this->vertexBufferId);
 		glGenBuffers(1, &this->colorBufferId);
@@ -42,23 +59,27 @@ public:
 	virtual ~GLMesh()
 	{
 
-		glDeleteBuffers(1, &this->vertexBufferId);
-		glDeleteBuffers(1, &this->colorBufferId);
-		glDeleteBuffers(1, &this->normalBufferId);
-		glDeleteBuffers(1, &this->uvBufferId);
-		glDeleteBuffers(1, &this->indexBufferId);
+		for (auto bufferId : { this->vertexBufferId, this->colorBufferId, this->normalBufferId, this->uvBufferId, this->indexBufferId })
+		{
+			glDeleteBuffers(1, &bufferId);
+			GLStateCache::ForgetBuffer(bufferId);
+		}
 
-		glDeleteVertexArrays(1, &this->vertexArrayId);
+		for (auto vertexArrayId : { this->vertexArrayId, this->positionArrayId })
+		{
+			glDeleteVertexArrays(1, &vertexArrayId);
+			GLStateCache::ForgetVertexArray(vertexArrayId);
+		}
 	}
 
 	void UpdateVertexBuffer()
 	{
-		glBindVertexArray(this->vertexArrayId);
+		GLStateCache::BindVertexArray(this->vertexArrayId);
 
 		GLsizei vertexBufferSize = VERTEX_DATA_SIZE * this->indices.size();
 		GLintptr vertexBufferOffset = 0;
 
-		glBindBuffer(GL_ARRAY_BUFFER, this->vertexBufferId);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, this->vertexBufferId);
 		glBufferData(GL_ARRAY_BUFFER, vertexBufferSize, NULL, GL_STATIC_DRAW);
 
 		for (const auto& index : this->indices)
@@ -74,17 +95,23 @@ public:
 		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
 		glEnableVertexAttribArray(0);
 
-		glBindVertexArray(0);
+		// Depth only passes fetch the positions and nothing else.
+		GLStateCache::BindVertexArray(this->positionArrayId);
+
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
+		glEnableVertexAttribArray(0);
+
+		GLStateCache::BindVertexArray(0);
 	}
 
 	void UpdateColorBuffer()
 	{
-		glBindVertexArray(this->vertexArrayId);
+		GLStateCache::BindVertexArray(this->vertexArrayId);
 
 		GLsizei colorBufferSize = COLOR_DATA_SIZE * this->colors.size();
 		GLintptr colorBufferOffset = 0;
 
-		glBindBuffer(GL_ARRAY_BUFFER, this->colorBufferId);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, this->colorBufferId);
 		glBufferData(GL_ARRAY_BUFFER, colorBufferSize, NULL, GL_STATIC_DRAW);
 
 		for (const auto& color : this->colors)
@@ -98,17 +125,17 @@ public:
 		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, 0);
 		glEnableVertexAttribArray(1);
 
-		glBindVertexArray(0);
+		GLStateCache::BindVertexArray(0);
 	}
 
 	void UpdateNormalBuffer()
 	{
-		glBindVertexArray(this->vertexArrayId);
+		GLStateCache::BindVertexArray(this->vertexArrayId);
 
 		GLsizei normalBufferSize = NORMAL_DATA_SIZE * this->normals.size();
 		GLintptr normalBufferOffset = 0;
 
-		glBindBuffer(GL_ARRAY_BUFFER, this->normalBufferId);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, this->normalBufferId);
 		glBufferData(GL_ARRAY_BUFFER, normalBufferSize, NULL, GL_STATIC_DRAW);
 
 		for (const auto& normal : this->normals)
@@ -124,17 +151,17 @@ public:
 		glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 0, 0);
 		glEnableVertexAttribArray(2);
 
-		glBindVertexArray(0);
+		GLStateCache::BindVertexArray(0);
 	}
 
 	void UpdateUVBuffer()
 	{
-		glBindVertexArray(this->vertexArrayId);
+		GLStateCache::BindVertexArray(this->vertexArrayId);
 
 		GLsizei uvBufferSize = UV_DATA_SIZE * this->uvs.size();
 		GLintptr uvBufferOffset = 0;
 
-		glBindBuffer(GL_ARRAY_BUFFER, this->uvBufferId);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, this->uvBufferId);
 		glBufferData(GL_ARRAY_BUFFER, uvBufferSize, NULL, GL_STATIC_DRAW);
 
 		for (const auto& uv : this->uvs)
@@ -153,6 +180,69 @@ public:
 		this->UpdateColorBuffer();
 		this->UpdateNormalBuffer();		
 		this->UpdateUVBuffer();
+
+		this->UpdateBounds();
+
+		this->version++;
+	}
+
+	// Uploads pending changes now instead of at the next draw.
+	void Flush()
+	{
+		if (this->updated)
+		{
+			this->Update();
+			this->updated = false;
+		}
+	}
+
+	// Incremented by every upload, copies of the vertex data elsewhere compare it to find stale ones.
+	unsigned int GetVersion()
+	{
+		return this->version;
+	}
+
+	void UpdateBounds()
+	{
+		this->bounds = GLBounds();
+
+		if (this->vertices.size() > 0)
+		{
+			this->bounds.Min = this->vertices[0];
+			this->bounds.Max = this->vertices[0];
+		}
+
+		for (const auto& vertex : this->vertices)
+		{
+			this->bounds.Min = glm::min(this->bounds.Min, vertex);
+			this->bounds.Max = glm::max(this->bounds.Max, vertex);
+		}
+
+		this->bounds.Center = (this->bounds.Min + this->bounds.Max) * 0.5f;
+
+		for (const auto& vertex : this->vertices)
+		{
+			this->bounds.Radius = glm::max(this->bounds.Radius, glm::length(vertex - this->bounds.Center));
+		}
+
+		this->bBoundsValid = true;
+	}
+
+	// Local space bounds of the vertices, recomputed by the first request after a change. Render
+	// commands are recorded by parallel jobs, which may share the mesh.
+	const GLBounds& GetBounds()
+	{
+		if (!this->bBoundsValid)
+		{
+			std::lock_guard<std::mutex> lock(this->boundsMutex);
+
+			if (!this->bBoundsValid)
+			{
+				this->UpdateBounds();
+			}
+		}
+
+		return this->bounds;
 	}
 
 	virtual void Render()
@@ -163,14 +253,65 @@ public:
 			this->updated = false;
 		}
 
-		glBindVertexArray(this->vertexArrayId);
+		GLStateCache::BindVertexArray(this->vertexArrayId);
+
+		if (this->indices.size() > 0)
+		{
+			glDrawArrays((GLenum)this->drawMode, 0, this->indices.size());
+		}
+	}
+
+	// Draws the mesh with only the position stream bound, for depth only shaders.
+	virtual void RenderPositions()
+	{
+		if (this->updated)
+		{
+			this->Update();
+			this->updated = false;
+		}
+
+		GLStateCache::BindVertexArray(this->positionArrayId);
 
 		if (this->indices.size() > 0)
 		{
 			glDrawArrays((GLenum)this->drawMode, 0, this->indices.size());
 		}
+	}
+
+	// Draws the mesh instanceCount times, shaders tell the instances apart by gl_InstanceID.
+	void RenderInstanced(GLsizei instanceCount)
+	{
+		if (this->updated)
+		{
+			this->Update();
+			this->updated = false;
+		}
+
+		GLStateCache::BindVertexArray(this->vertexArrayId);
+
+		if (this->indices.size() > 0 && instanceCount > 0)
+		{
+			glDrawArraysInstanced((GLenum)this->drawMode, 0, this->indices.size(), instanceCount);
+		}
+	}
+
+	// Draws count instances with the attributes in instances from first on, positions only for depth passes.
+	virtual void RenderInstances(GLInstanceBuffer& instances, GLsizei first, GLsizei count, bool bPositionsOnly = false)
+	{
+		if (this->updated)
+		{
+			this->Update();
+			this->updated = false;
+		}
+
+		GLStateCache::BindVertexArray(bPositionsOnly ? this->positionArrayId : this->vertexArrayId);
+
+		if (this->indices.size() > 0 && count > 0)
+		{
+			instances.BindAttributes(first);
 
-		glBindVertexArray(0);
+			glDrawArraysInstanced((GLenum)this->drawMode, 0, this->indices.size(), count);
+		}
 	}
 
 	void SetDrawMode(GLMeshDrawMode drawMode)
@@ -183,6 +324,18 @@ public:
 		return this->drawMode;
 	}
 
+	// Small id unique to the mesh, render queue keys group draws of the same mesh with it.
+	unsigned int GetSortId()
+	{
+		return this->sortId;
+	}
+
+	// Whether the mesh is drawn without face culling, whatever its renderer asks for.
+	virtual bool IsDoubleSided()
+	{
+		return false;
+	}
+
 
 	glm::vec3 GetVertex(int arrayIndex)
 	{
@@ -202,21 +355,21 @@ public:
 
 		this->vertices.at(arrayIndex) = vertex;
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void AddVertex(const glm::vec3& vertex)
 	{
 		this->vertices.push_back(vertex);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void AddVertices(const std::initializer_list<glm::vec3>& vertices)
 	{
 		this->vertices.insert(this->vertices.end(), vertices);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void RemoveVertex(int arrayIndex)
@@ -225,7 +378,7 @@ public:
 
 		this->vertices.erase(this->vertices.begin() + arrayIndex);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void RemoveVertices(const std::initializer_list<int>& vertexIndices)
@@ -235,14 +388,14 @@ public:
 			this->RemoveVertex(index);
 		}
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void ClearVertices()
 	{
 		this->vertices.clear();
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	size_t GetVertexCount()
@@ -268,21 +421,21 @@ public:
 
 		this->colors.at(arrayIndex) = color;
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void AddColor(const GLColor& color)
 	{
 		this->colors.push_back(color);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void AddColors(const std::initializer_list<GLColor>& colors)
 	{
 		this->colors.insert(this->colors.end(), colors);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void RemoveColor(int arrayIndex)
@@ -291,7 +444,7 @@ public:
 
 		this->colors.erase(this->colors.begin() + arrayIndex);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void RemoveColors(const std::initializer_list<int>& colorIndices)
@@ -301,14 +454,14 @@ public:
 			this->RemoveColor(index);
 		}
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void ClearColors()
 	{
 		this->colors.clear();
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	size_t GetColorCount()
@@ -334,21 +487,21 @@ public:
 
 		this->normals.at(arrayIndex) = normal;
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void AddNormal(const glm::vec3& normal)
 	{
 		this->normals.push_back(normal);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void AddNormals(const std::initializer_list<glm::vec3>& normals)
 	{
 		this->normals.insert(this->normals.end(), normals);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void RemoveNormal(int arrayIndex)
@@ -357,7 +510,7 @@ public:
 
 		this->vertices.erase(this->vertices.begin() + arrayIndex);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void RemoveNormals(const std::initializer_list<int>& normalIndices)
@@ -367,7 +520,7 @@ public:
 			this->RemoveNormal(index);
 		}
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	size_t GetNormalCount()
@@ -379,7 +532,7 @@ public:
 	{
 		this->normals.clear();
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	glm::vec2 GetUV(int arrayIndex)
@@ -400,21 +553,21 @@ public:
 
 		this->uvs.at(arrayIndex) = uv;
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void AddUV(const glm::vec2& uv)
 	{
 		this->uvs.push_back(uv);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void AddUVs(const std::initializer_list<glm::vec2>& uvs)
 	{
 		this->uvs.insert(this->uvs.end(), uvs);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void RemoveUV(int arrayIndex)
@@ -423,7 +576,7 @@ public:
 
 		this->vertices.erase(this->vertices.begin() + arrayIndex);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void RemoveUVs(const std::initializer_list<int>& uvIndices)
@@ -433,7 +586,7 @@ public:
 			this->RemoveUV(index);
 		}
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	size_t GetUVCount()
@@ -445,7 +598,7 @@ public:
 	{
 		this->uvs.clear();
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	GLuint GetIndex(int arrayIndex)
@@ -471,14 +624,14 @@ public:
 
 		this->indices.at(arrayIndex) = index;
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void AddIndex(GLuint index)
 	{
 		this->indices.push_back(index);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void AddIndices(const std::initializer_list<GLuint>& indices)
@@ -488,7 +641,7 @@ public:
 			this->AddIndex(index);
 		}
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void RemoveIndex(int arrayIndex)
@@ -497,14 +650,14 @@ public:
 		
 		this->indices.erase(this->indices.begin() + arrayIndex);
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 	void ClearIndices()
 	{
 		this->indices.clear();
 
-		this->updated = true;
+		this->MarkUpdated();
 	}
 
 protected:
@@ -515,7 +668,15 @@ protected:
 	std::vector<glm::vec2> uvs;
 
 private:
+	// Pending changes are uploaded at the next draw.
+	void MarkUpdated()
+	{
+		this->updated = true;
+		this->bBoundsValid = false;
+	}
+
 	unsigned int vertexArrayId;
+	unsigned int positionArrayId;
 
 	unsigned int vertexBufferId;
 	unsigned int colorBufferId;
@@ -525,5 +686,16 @@ private:
 
 	GLMeshDrawMode drawMode = GLMeshDrawMode::Triangle;
 
+	unsigned int sortId = nextSortId++;
+	unsigned int version = 0;
+
+	GLBounds bounds;
+	std::atomic<bool> bBoundsValid { false };
+	std::mutex boundsMutex;
+
 	bool updated = false;
+
+	static unsigned int nextSortId;
 };
+
+unsigned int GLMesh::nextSortId = 0;
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <gl/glew.h>
 #include <gl/glm/glm.hpp>
@@ -10,11 +12,30 @@
 #include "GLShader.h"
 #include "GLMesh.h"
 #include "GLMaterial.h"
+#include "GLBasicShader.h"
 #include "GLLight.h"
-
-#define MAX_DIRECTIONAL_LIGHT_COUNT 16
-#define MAX_POINT_LIGHT_COUNT 16
-#define MAX_SPOT_LIGHT_COUNT 16
+#include "GLLightBuffer.h"
+#include "GLLightClusters.h"
+#include "GLInstanceBuffer.h"
+#include "GLGeometryPool.h"
+#include "GLDrawCommandBuffer.h"
+#include "GLStateCache.h"
+
+#define MAX_DIRECTIONAL_LIGHT_COUNT GLMaterialShader::MAX_LIGHT_COUNT
+#define MAX_POINT_LIGHT_COUNT GLMaterialShader::MAX_LIGHT_COUNT
+#define MAX_SPOT_LIGHT_COUNT GLMaterialShader::MAX_LIGHT_COUNT
+
+// Which renderers draw in the current pass. Deferred cameras draw opaque renderers with built-in
+// materials into the G-buffer, cameras with a depth pre-pass draw their depth first and shade them
+// in the Opaque pass. The rest is forward rendered afterwards in ForwardFallback.
+enum class GLRenderPass
+{
+	Forward,
+	GBuffer,
+	DepthPrePass,
+	Opaque,
+	ForwardFallback
+};
 
 class GLMeshRenderer
 {
@@ -36,83 +57,290 @@ public:
 		this->mesh->Update();
 	}
 
-	void Render(const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const glm::vec3 cameraPosition)
+	void Render(const glm::mat4& modelMatrix)
 	{
 		this->material->Use();
 
-		auto shader = this->material->GetShader();
+		const auto& shader = this->material->GetShader();
 
-		shader->SetUniform("model", modelMatrix);
-		shader->SetUniform("view", viewMatrix);
-		shader->SetUniform("projection", projectionMatrix);
-		shader->SetUniform("viewPosition", cameraPosition);
+		// Camera state comes from the Camera uniform block bound by the scene.
+		shader->SetUniform(modelUniform, modelMatrix);
 
 		this->mesh->Render();
 	}
 
-	void Render(const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const glm::vec3 cameraPosition,
-		        const std::vector<GLSharedPtr<GLLight>>& lights)
+	// Light list draws use the selection recorded for them, or select their lights here without one.
+	void Render(const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const GLLightBuffer& lights, const GLLightSelection* selection = nullptr)
 	{
-		this->material->Use();
+		if (!this->IsInPass())
+		{
+			return;
+		}
+
+		if (renderPass == GLRenderPass::DepthPrePass)
+		{
+			this->RenderDepth(modelMatrix);
+			return;
+		}
+
+		// Lights come from the Lights uniform block packed by the scene. With light lists, only the
+		// indices of the point and spot lights reaching this object are set per draw. Clustered
+		// shading finds its lights per fragment in the cluster buffers bound by the camera.
+		bool bClustered = this->IsClusteredDraw();
+		bool bLightList = this->IsLightListDraw();
+
+		this->SelectVariant(lights);
+
+		if (bLightList && selection == nullptr)
+		{
+			glm::vec3 center;
+			float radius;
+
+			this->GetWorldSphere(modelMatrix, center, radius);
+			lights.Select(center, radius, lightListSize, lightSelection);
+
+			selection = &lightSelection;
+		}
 
-		auto shader = this->material->GetShader();
+		this->material->Use();
 
-		shader->SetUniform("model", modelMatrix);
-		shader->SetUniform("view", viewMatrix);
-		shader->SetUniform("projection", projectionMatrix);
-		shader->SetUniform("cameraPosition", cameraPosition);
+		const auto& shader = this->material->GetShader();
 
-		int directionalCount = 0;
-		int pointCount = 0;
-		int spotCount = 0;
+		shader->SetUniform(modelUniform, modelMatrix);
 
-		for (int i = 0; i < lights.size(); ++i)
+		if (bClustered)
 		{
-			auto directionalLight = std::dynamic_pointer_cast<GLDirectionalLight>(lights[i]);
-			if (directionalLight != nullptr && directionalLight->GetActive())
+			SetClusterUniforms(shader);
+		}
+		else if (bLightList)
+		{
+			shader->SetUniform(lightDataUniform, (int)GLTextureUnit::LightData);
+			shader->SetUniform(lightListCountsUniform, glm::tvec2<int>(selection->PointCount, selection->SpotCount));
+
+			for (int i = 0; i < selection->PointCount; ++i)
 			{
-				directionalLight->Apply(shader, directionalCount++);
+				shader->SetUniform(pointLightIndexUniforms[i], selection->PointIndices[i]);
 			}
 
-			auto pointLight = std::dynamic_pointer_cast<GLPointLight>(lights[i]);
-			if (pointLight != nullptr && pointLight->GetActive())
+			for (int i = 0; i < selection->SpotCount; ++i)
 			{
-				pointLight->Apply(shader, pointCount++);
+				shader->SetUniform(spotLightIndexUniforms[i], selection->SpotIndices[i]);
 			}
+		}
+
+		this->RequestDetail(modelMatrix, viewMatrix, projectionMatrix);
+
+		this->SetDrawState(this->DoBlend());
 
-			auto spotLight = std::dynamic_pointer_cast<GLSpotLight>(lights[i]);
-			if (spotLight != nullptr && spotLight->GetActive())
+		this->mesh->Render();
+	}
+
+	// Draws renderers sharing this renderer's mesh, diffuse source and face culling as count instances,
+	// their model matrices and colors are in instances from first on. Light list draws are never
+	// instanced, see IsInstanceable, so instances are shaded with all lights.
+	void RenderInstances(GLInstanceBuffer& instances, GLsizei first, GLsizei count, const GLLightBuffer& lights)
+	{
+		if (!this->IsInPass())
+		{
+			return;
+		}
+
+		bool bDepth = renderPass == GLRenderPass::DepthPrePass;
+
+		if (bDepth)
+		{
+			GetDepthShader(true)->Use();
+		}
+		else
+		{
+			auto shader = this->GetInstancedShader(lights);
+
+			this->material->UseInstanced(shader);
+
+			if (this->IsClusteredDraw())
 			{
-				spotLight->Apply(shader, spotCount++);
+				SetClusterUniforms(shader);
 			}
 		}
 
-		shader->SetUniform("directionalLightCount", directionalCount);
-		shader->SetUniform("pointLightCount", pointCount);
-		shader->SetUniform("spotLightCount", spotCount);
+		this->SetDrawState(false);
+
+		this->mesh->RenderInstances(instances, first, count, bDepth);
+	}
 
-		if (this->DoBlend())
+	// Draws count commands from firstCommand on with one multi-draw call from the geometry pool. The
+	// renderers of the commands share this renderer's program, diffuse source, face culling and draw
+	// mode, draw i reads its model matrix and colors from entry firstDraw + i of the Draws block.
+	void RenderMultiDraw(GLGeometryPool& pool, GLDrawCommandBuffer& commands, GLsizei firstCommand, GLsizei count, GLint firstDraw, const GLLightBuffer& lights)
+	{
+		if (!this->IsInPass())
 		{
-			glEnable(GL_BLEND);
-			glBlendFunc(this->blendSFactor, this->blendDFactor);
+			return;
 		}
 
-		if (this->DoCullFace())
+		GLSharedPtr<GLShader> shader = nullptr;
+
+		if (renderPass == GLRenderPass::DepthPrePass)
 		{
-			glEnable(GL_CULL_FACE);
+			shader = GetMultiDrawDepthShader();
+			shader->Use();
 		}
+		else
+		{
+			shader = this->GetInstancedShader(lights, true);
 
-		this->mesh->Render();
+			this->material->UseInstanced(shader);
+
+			if (this->IsClusteredDraw())
+			{
+				SetClusterUniforms(shader);
+			}
+		}
+
+		shader->SetUniform(drawOffsetUniform, firstDraw);
+
+		this->SetDrawState(false);
+
+		pool.Bind();
+		commands.Draw((GLenum)this->mesh->GetDrawMode(), firstCommand, count);
+	}
+
+	// Opaque renderers with built-in materials can be drawn as instances of their mesh. Light list
+	// draws are drawn one by one, as their lights are picked per object and set as uniforms, so an
+	// object is lit the same whether or not it shares a run. Checked when the draw is recorded.
+	bool IsInstanceable()
+	{
+		return this->IsOpaque() && !this->IsLightListDraw();
+	}
+
+	// Forwards the on-screen size to the streaming of the diffuse map, if there is one.
+	void RequestDetail(const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+	{
+		if (this->material->GetDiffuseMap() != nullptr)
+		{
+			this->material->RequestDetail(this->GetScreenSize(modelMatrix, viewMatrix, projectionMatrix));
+		}
+	}
+
+	// Selects the material variant drawn in the current pass, the render queue sorts by its program.
+	void SelectVariant(const GLLightBuffer& lights)
+	{
+		if (this->IsGBufferDraw())
+		{
+			this->material->SelectGBufferVariant();
+		}
+		else if (this->IsClusteredDraw())
+		{
+			this->material->SelectClusteredVariant();
+		}
+		else if (this->IsLightListDraw())
+		{
+			this->material->SelectLightListVariant(lightListSize);
+		}
+		else
+		{
+			this->material->SelectVariant(lights.GetDirectionalCount(), lights.GetPointCount(), lights.GetSpotCount());
+		}
+	}
+
+	bool IsInPass()
+	{
+		return renderPass == GLRenderPass::Forward || this->IsOpaque() != (renderPass == GLRenderPass::ForwardFallback);
+	}
+
+	// Whether the lights of the draw are picked per object, see SetLightListSize. Renderers drawn
+	// into the G-buffer or with clustered lighting, and custom shaders, take no light list.
+	bool IsLightListDraw()
+	{
+		return !this->IsGBufferDraw() && lightListSize > 0 && !bClusteredLighting && !this->material->HasCustomShader();
+	}
+
+	// Opaque renderers with built-in materials take part in the G-buffer and depth pre-pass,
+	// blended renderers and custom shaders are always forward rendered.
+	bool IsOpaque()
+	{
+		return !this->DoBlend() && !this->material->HasCustomShader();
+	}
 
-		if (glIsEnabled(GL_BLEND))
+	// Bounding sphere of the mesh in world space.
+	void GetWorldSphere(const glm::mat4& modelMatrix, glm::vec3& center, float& radius)
+	{
+		const auto& bounds = this->mesh->GetBounds();
+
+		float scale = glm::max(glm::length(glm::vec3(modelMatrix[0])),
+			glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+
+		center = glm::vec3(modelMatrix * glm::vec4(bounds.Center, 1.0f));
+		radius = bounds.Radius * scale;
+	}
+
+	// Approximate on-screen diameter in pixels of the mesh bounding sphere.
+	float GetScreenSize(const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+	{
+		const auto& bounds = this->mesh->GetBounds();
+
+		float scale = glm::max(glm::length(glm::vec3(modelMatrix[0])),
+			glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+		float radius = bounds.Radius * scale;
+
+		glm::vec4 viewCenter = viewMatrix * modelMatrix * glm::vec4(bounds.Center, 1.0f);
+
+		if (projectionMatrix[3][3] == 1.0f)
 		{
-			glDisable(GL_BLEND);
+			return radius * projectionMatrix[1][1] * viewportHeight;
 		}
 
-		if (glIsEnabled(GL_CULL_FACE))
+		float depth = -viewCenter.z;
+
+		if (depth <= radius)
 		{
-			glDisable(GL_CULL_FACE);
+			return viewportHeight;
 		}
+
+		return radius * projectionMatrix[1][1] / depth * viewportHeight;
+	}
+
+	static int GetLightListSize()
+	{
+		return lightListSize;
+	}
+
+	// Most point and spot lights shading one object, 0 shades every object with all lights.
+	static void SetLightListSize(int size)
+	{
+		lightListSize = glm::clamp(size, 0, GLMaterialShader::MAX_LIGHT_COUNT);
+	}
+
+	static GLRenderPass GetRenderPass()
+	{
+		return renderPass;
+	}
+
+	static void SetRenderPass(GLRenderPass pass)
+	{
+		renderPass = pass;
+	}
+
+	static bool IsClusteredLighting()
+	{
+		return bClusteredLighting;
+	}
+
+	// Whether the camera being rendered assigned lights to clusters, see GCamera::SetClusteredLighting.
+	static void SetClusteredLighting(bool bClustered)
+	{
+		bClusteredLighting = bClustered;
+	}
+
+	static float GetViewportHeight()
+	{
+		return viewportHeight;
+	}
+
+	// Pixel height of the viewport currently being rendered, used for screen size estimates.
+	static void SetViewportHeight(float height)
+	{
+		viewportHeight = height;
 	}
 
 	GLSharedPtr<GLMesh>& GetMesh()
@@ -176,6 +404,98 @@ public:
 	}
 
 private:
+	bool IsGBufferDraw()
+	{
+		return renderPass == GLRenderPass::GBuffer && this->IsOpaque();
+	}
+
+	bool IsClusteredDraw()
+	{
+		return !this->IsGBufferDraw() && bClusteredLighting && !this->material->HasCustomShader();
+	}
+
+	// Built-in variant of the current pass reading the model matrix and colors per instance,
+	// or per draw of a multi-draw call.
+	GLSharedPtr<GLShader> GetInstancedShader(const GLLightBuffer& lights, bool bMultiDraw = false)
+	{
+		GLDiffuseSource diffuseSource = this->material->GetDiffuseSource();
+		GLShaderDefines defines;
+
+		if (this->IsGBufferDraw())
+		{
+			defines = GLMaterialShader::GetGBufferDefines(diffuseSource);
+		}
+		else if (this->IsClusteredDraw())
+		{
+			defines = GLMaterialShader::GetClusteredDefines(diffuseSource);
+		}
+		else
+		{
+			defines = GLMaterialShader::GetDefines(diffuseSource,
+				glm::min(lights.GetDirectionalCount(), GLMaterialShader::MAX_LIGHT_COUNT),
+				glm::min(lights.GetPointCount(), GLMaterialShader::MAX_LIGHT_COUNT),
+				glm::min(lights.GetSpotCount(), GLMaterialShader::MAX_LIGHT_COUNT));
+		}
+
+		return GLMaterialShader::Get(bMultiDraw ? GLGetMultiDrawDefines(defines) : GLGetInstancedDefines(defines));
+	}
+
+	static const GLSharedPtr<GLShader>& GetDepthShader(bool bInstanced)
+	{
+		auto& shader = bInstanced ? instancedDepthShader : depthShader;
+
+		if (shader == nullptr)
+		{
+			shader = GLDepthShader::Get(bInstanced ? GLGetInstancedDefines() : GLShaderDefines());
+		}
+
+		return shader;
+	}
+
+	static const GLSharedPtr<GLShader>& GetMultiDrawDepthShader()
+	{
+		if (multiDrawDepthShader == nullptr)
+		{
+			multiDrawDepthShader = GLDepthShader::Get(GLGetMultiDrawDefines());
+		}
+
+		return multiDrawDepthShader;
+	}
+
+	static void SetClusterUniforms(const GLSharedPtr<GLShader>& shader)
+	{
+		shader->SetUniform(lightDataUniform, (int)GLTextureUnit::LightData);
+		shader->SetUniform(clusterRangesUniform, (int)GLTextureUnit::ClusterRanges);
+		shader->SetUniform(clusterLightIndicesUniform, (int)GLTextureUnit::ClusterLightIndices);
+	}
+
+	// Position only draw into the depth buffer, culled the same way as the color pass.
+	void RenderDepth(const glm::mat4& modelMatrix)
+	{
+		const auto& depthShader = GetDepthShader(false);
+
+		depthShader->Use();
+		depthShader->SetUniform(modelUniform, modelMatrix);
+
+		this->SetDrawState(false);
+
+		this->mesh->RenderPositions();
+	}
+
+	// Blending and face culling of the draw. Every draw sets both instead of restoring them after,
+	// so the state cache skips them while consecutive draws agree.
+	void SetDrawState(bool bBlend)
+	{
+		GLStateCache::SetEnabled(GL_BLEND, bBlend);
+
+		if (bBlend)
+		{
+			GLStateCache::SetBlendFunc(this->blendSFactor, this->blendDFactor);
+		}
+
+		GLStateCache::SetEnabled(GL_CULL_FACE, this->DoCullFace() && !this->mesh->IsDoubleSided());
+	}
+
 	GLSharedPtr<GLMesh> mesh = nullptr;
 	GLSharedPtr<GLMaterial> material = nullptr;
 
@@ -184,4 +504,58 @@ private:
 
 	GLenum blendSFactor = GL_SRC_ALPHA;
 	GLenum blendDFactor = GL_ONE_MINUS_SRC_ALPHA;
-};
\ No newline at end of file
+
+	static float viewportHeight;
+
+	static int lightListSize;
+	static GLLightSelection lightSelection;
+
+	static bool bClusteredLighting;
+	static GLRenderPass renderPass;
+	static GLSharedPtr<GLShader> depthShader;
+	static GLSharedPtr<GLShader> instancedDepthShader;
+	static GLSharedPtr<GLShader> multiDrawDepthShader;
+
+	static const GLUniformHandle<glm::mat4> modelUniform;
+	static const GLUniformHandle<int> drawOffsetUniform;
+	static const GLUniformHandle<glm::tvec2<int>> lightListCountsUniform;
+	static const std::vector<GLUniformHandle<int>> pointLightIndexUniforms;
+	static const std::vector<GLUniformHandle<int>> spotLightIndexUniforms;
+
+	static const GLUniformHandle<int> lightDataUniform;
+	static const GLUniformHandle<int> clusterRangesUniform;
+	static const GLUniformHandle<int> clusterLightIndicesUniform;
+
+	static std::vector<GLUniformHandle<int>> CreateIndexUniforms(const std::string& arrayName)
+	{
+		std::vector<GLUniformHandle<int>> uniforms;
+
+		for (int i = 0; i < GLMaterialShader::MAX_LIGHT_COUNT; ++i)
+		{
+			uniforms.emplace_back(arrayName + "[" + std::to_string(i) + "]");
+		}
+
+		return uniforms;
+	}
+};
+
+float GLMeshRenderer::viewportHeight = 0.0f;
+
+int GLMeshRenderer::lightListSize = 8;
+GLLightSelection GLMeshRenderer::lightSelection;
+
+bool GLMeshRenderer::bClusteredLighting = false;
+GLRenderPass GLMeshRenderer::renderPass = GLRenderPass::Forward;
+GLSharedPtr<GLShader> GLMeshRenderer::depthShader = nullptr;
+GLSharedPtr<GLShader> GLMeshRenderer::instancedDepthShader = nullptr;
+GLSharedPtr<GLShader> GLMeshRenderer::multiDrawDepthShader = nullptr;
+
+const GLUniformHandle<glm::mat4> GLMeshRenderer::modelUniform(GLHashName("model"));
+const GLUniformHandle<int> GLMeshRenderer::drawOffsetUniform(GLHashName("drawOffset"));
+const GLUniformHandle<glm::tvec2<int>> GLMeshRenderer::lightListCountsUniform(GLHashName("lightListCounts"));
+const std::vector<GLUniformHandle<int>> GLMeshRenderer::pointLightIndexUniforms = GLMeshRenderer::CreateIndexUniforms("pointLightIndices");
+const std::vector<GLUniformHandle<int>> GLMeshRenderer::spotLightIndexUniforms = GLMeshRenderer::CreateIndexUniforms("spotLightIndices");
+
+const GLUniformHandle<int> GLMeshRenderer::lightDataUniform(GLHashName("lightData"));
+const GLUniformHandle<int> GLMeshRenderer::clusterRangesUniform(GLHashName("clusterRanges"));
+const GLUniformHandle<int> GLMeshRenderer::clusterLightIndicesUniform(GLHashName("clusterLightIndices"));
\ No newline at end of file
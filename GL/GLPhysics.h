@@ -61,7 +61,7 @@ public:
 
 	}
 
-	void Render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const glm::vec3& cameraPosition)
+	void Render()
 	{
 		auto& renderer = this->World->getDebugRenderer();
 
@@ -97,7 +97,7 @@ public:
 
 		if (index > 0)
 		{
-			this->DebugMeshRenderer->Render(glm::mat4(1.0f), viewMatrix, projectionMatrix, cameraPosition);
+			this->DebugMeshRenderer->Render(glm::mat4(1.0f));
 		}
 	}
 
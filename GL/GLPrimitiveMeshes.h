@@ -1,5 +1,9 @@
 #pragma once
 
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+
 #include "GLColor.h"
 #include "GLMesh.h"
 
@@ -292,18 +296,42 @@ public:
 
 	}
 
+	bool IsDoubleSided() override
+	{
+		return true;
+	}
+
 	void Render() override
 	{
-		bool faceCullingEnabled = glIsEnabled(GL_CULL_FACE);
+		bool faceCullingEnabled = GLStateCache::IsEnabled(GL_CULL_FACE);
 
-		glDisable(GL_CULL_FACE);
+		GLStateCache::SetEnabled(GL_CULL_FACE, false);
 
 		GLMesh::Render();
 
-		if (faceCullingEnabled)
-		{
-			glEnable(GL_CULL_FACE);
-		}
+		GLStateCache::SetEnabled(GL_CULL_FACE, faceCullingEnabled);
+	}
+
+	void RenderPositions() override
+	{
+		bool faceCullingEnabled = GLStateCache::IsEnabled(GL_CULL_FACE);
+
+		GLStateCache::SetEnabled(GL_CULL_FACE, false);
+
+		GLMesh::RenderPositions();
+
+		GLStateCache::SetEnabled(GL_CULL_FACE, faceCullingEnabled);
+	}
+
+	void RenderInstances(GLInstanceBuffer& instances, GLsizei first, GLsizei count, bool bPositionsOnly = false) override
+	{
+		bool faceCullingEnabled = GLStateCache::IsEnabled(GL_CULL_FACE);
+
+		GLStateCache::SetEnabled(GL_CULL_FACE, false);
+
+		GLMesh::RenderInstances(instances, first, count, bPositionsOnly);
+
+		GLStateCache::SetEnabled(GL_CULL_FACE, faceCullingEnabled);
 	}
 };
 
@@ -683,4 +711,26 @@ public:
 			this->AddColor(color);
 		}
 	}
-};
\ No newline at end of file
+};
+
+std::unordered_map<std::string, GLSharedPtr<GLMesh>> __GLSharedPrimitiveMeshes;
+
+// One mesh per primitive type and parameters, shared by the primitive objects so the render queue
+// can draw them as instances. Objects needing geometry of their own are given a new mesh with SetMesh.
+template<typename TMesh, typename... TArgs>
+GLSharedPtr<GLMesh> GLGetSharedPrimitiveMesh(const TArgs&... args)
+{
+	std::string key = typeid(TMesh).name();
+
+	int parameters[] = { 0, (key.append(reinterpret_cast<const char*>(&args), sizeof(args)), 0)... };
+	(void)parameters;
+
+	auto& mesh = __GLSharedPrimitiveMeshes[key];
+
+	if (mesh == nullptr)
+	{
+		mesh = GLCreate<TMesh>(args...);
+	}
+
+	return mesh;
+}
\ No newline at end of file
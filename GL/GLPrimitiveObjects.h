@@ -13,7 +13,7 @@ public:
 		auto meshRenderer = this->GetMeshRenderer();
 
 		meshRenderer->SetMesh(GLCreate<GLLineMesh>(color));
-		meshRenderer->GetMaterial()->SetShader(GLCreate<GLBasicShader>());
+		meshRenderer->GetMaterial()->SetShader(GLBasicShader::Get());
 	}
 };
 
@@ -26,7 +26,7 @@ public:
 		auto meshRenderer = this->GetMeshRenderer();
 
 		meshRenderer->SetMesh(GLCreate<GLAxis1DMesh>(color));
-		meshRenderer->GetMaterial()->SetShader(GLCreate<GLBasicShader>());
+		meshRenderer->GetMaterial()->SetShader(GLBasicShader::Get());
 	}
 };
 
@@ -39,7 +39,7 @@ public:
 		auto meshRenderer = this->GetMeshRenderer();
 
 		meshRenderer->SetMesh(GLCreate<GLAxis2DMesh>(color));
-		meshRenderer->GetMaterial()->SetShader(GLCreate<GLBasicShader>());
+		meshRenderer->GetMaterial()->SetShader(GLBasicShader::Get());
 	}
 };
 
@@ -52,7 +52,7 @@ public:
 		auto meshRenderer = this->GetMeshRenderer();
 
 		meshRenderer->SetMesh(GLCreate<GLAxis3DMesh>(color));
-		meshRenderer->GetMaterial()->SetShader(GLCreate<GLBasicShader>());
+		meshRenderer->GetMaterial()->SetShader(GLBasicShader::Get());
 	}
 };
 
@@ -65,7 +65,7 @@ public:
 		auto meshRenderer = this->GetMeshRenderer();
 
 		meshRenderer->SetMesh(GLCreate<GLLineTriangleMesh>(color));
-		meshRenderer->GetMaterial()->SetShader(GLCreate<GLBasicShader>());
+		meshRenderer->GetMaterial()->SetShader(GLBasicShader::Get());
 	}
 };
 
@@ -78,7 +78,7 @@ public:
 		auto meshRenderer = this->GetMeshRenderer();
 
 		meshRenderer->SetMesh(GLCreate<GLLineRectangleMesh>(color));
-		meshRenderer->GetMaterial()->SetShader(GLCreate<GLBasicShader>());
+		meshRenderer->GetMaterial()->SetShader(GLBasicShader::Get());
 	}
 };
 
@@ -92,7 +92,7 @@ public:
 		auto meshRenderer = this->GetMeshRenderer();
 
 		meshRenderer->SetMesh(GLCreate<GLLineCircleMesh>(vertices, color));
-		meshRenderer->GetMaterial()->SetShader(GLCreate<GLBasicShader>());
+		meshRenderer->GetMaterial()->SetShader(GLBasicShader::Get());
 	}
 };
 
@@ -105,7 +105,7 @@ public:
 		auto meshRenderer = this->GetMeshRenderer();
 
 		meshRenderer->SetMesh(GLCreate<GLLineCubeMesh>(color));
-		meshRenderer->GetMaterial()->SetShader(GLCreate<GLBasicShader>());
+		meshRenderer->GetMaterial()->SetShader(GLBasicShader::Get());
 	}
 };
 
@@ -119,7 +119,7 @@ public:
 		auto meshRenderer = this->GetMeshRenderer();
 
 		meshRenderer->SetMesh(GLCreate<GLLineConeMesh>(vertices, color));
-		meshRenderer->GetMaterial()->SetShader(GLCreate<GLBasicShader>());
+		meshRenderer->GetMaterial()->SetShader(GLBasicShader::Get());
 	}
 };
 
@@ -133,7 +133,7 @@ public:
 		auto meshRenderer = this->GetMeshRenderer();
 
 		meshRenderer->SetMesh(GLCreate<GLLineCylinderMesh>(vertices, color));
-		meshRenderer->GetMaterial()->SetShader(GLCreate<GLBasicShader>());
+		meshRenderer->GetMaterial()->SetShader(GLBasicShader::Get());
 	}
 };
 
@@ -145,7 +145,7 @@ public:
 	{
 		auto meshRenderer = this->GetMeshRenderer();
 
-		meshRenderer->SetMesh(GLCreate<GLTriangleMesh>(color));
+		meshRenderer->SetMesh(GLGetSharedPrimitiveMesh<GLTriangleMesh>(color));
 	}
 };
 
@@ -157,7 +157,7 @@ public:
 	{
 		auto meshRenderer = this->GetMeshRenderer();
 
-		meshRenderer->SetMesh(GLCreate<GLRectangleMesh>(color));
+		meshRenderer->SetMesh(GLGetSharedPrimitiveMesh<GLRectangleMesh>(color));
 	}
 };
 
@@ -170,7 +170,7 @@ public:
 	{
 		auto meshRenderer = this->GetMeshRenderer();
 
-		meshRenderer->SetMesh(GLCreate<GLCircleMesh>(vertices, color));
+		meshRenderer->SetMesh(GLGetSharedPrimitiveMesh<GLCircleMesh>(vertices, color));
 	}
 };
 
@@ -182,7 +182,7 @@ public:
 	{
 		auto meshRenderer = this->GetMeshRenderer();
 
-		meshRenderer->SetMesh(GLCreate<GLCubeMesh>(color));
+		meshRenderer->SetMesh(GLGetSharedPrimitiveMesh<GLCubeMesh>(color));
 	}
 };
 
@@ -195,7 +195,7 @@ public:
 	{
 		auto meshRenderer = this->GetMeshRenderer();
 
-		meshRenderer->SetMesh(GLCreate<GLUVSphereMesh>(segments, rings, color));
+		meshRenderer->SetMesh(GLGetSharedPrimitiveMesh<GLUVSphereMesh>(segments, rings, color));
 	}
 };
 
@@ -208,7 +208,7 @@ public:
 	{
 		auto meshRenderer = this->GetMeshRenderer();
 
-		meshRenderer->SetMesh(GLCreate<GLIcoSphereMesh>(subdivisions, color));
+		meshRenderer->SetMesh(GLGetSharedPrimitiveMesh<GLIcoSphereMesh>(subdivisions, color));
 	}
 };
 
@@ -221,7 +221,7 @@ public:
 	{
 		auto meshRenderer = this->GetMeshRenderer();
 
-		meshRenderer->SetMesh(GLCreate<GLConeMesh>(vertices, color));
+		meshRenderer->SetMesh(GLGetSharedPrimitiveMesh<GLConeMesh>(vertices, color));
 	}
 };
 
@@ -234,6 +234,6 @@ public:
 	{
 		auto meshRenderer = this->GetMeshRenderer();
 
-		meshRenderer->SetMesh(GLCreate<GLCylinderMesh>(vertices, color));
+		meshRenderer->SetMesh(GLGetSharedPrimitiveMesh<GLCylinderMesh>(vertices, color));
 	}
 };
\ No newline at end of file
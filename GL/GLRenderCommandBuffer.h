@@ -0,0 +1,292 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <gl/glm/glm.hpp>
+
+#include "GLMemoryHelpers.h"
+#include "GLMeshRenderer.h"
+#include "GLLightBuffer.h"
+#include "GLFrustum.h"
+
+// One mesh renderer recorded for a camera, with everything about it that needs no GL.
+struct GLRecordedDraw
+{
+	GLMeshRenderer* Renderer = nullptr;
+	const glm::mat4* Model = nullptr;
+
+	// View space depth of the bounding sphere center.
+	float Depth = 0.0f;
+
+	// Light selection in the arena of the buffer, below 0 for draws without a light list.
+	int Lights = -1;
+
+	bool bInstanceable = false;
+	bool bCullFace = false;
+};
+
+// Draws recorded by one job of the parallel scene walk. Besides the transforms of its own subtrees
+// a job only reads the scene and the light buffer, so every job fills its own buffer at the same time.
+// The GL thread then merges the buffers into the render queue in order, which selects variants,
+// sorts and submits. Once recorded, the draws are culled against the frustum of the camera and the
+// lights of visible light list draws are picked, kept in a linear arena that is reused every frame.
+class GLRenderCommandBuffer
+{
+public:
+	// Starts recording for a camera, the lights have to stay in place until the queue is submitted.
+	// Without a frustum nothing is culled.
+	void Begin(const glm::mat4& viewMatrix, const GLFrustum* frustum, const GLLightBuffer& lights)
+	{
+		this->draws.clear();
+		this->lightSelections.clear();
+
+		this->centerX.clear();
+		this->centerY.clear();
+		this->centerZ.clear();
+		this->radii.clear();
+
+		this->groups.clear();
+		this->openGroups.clear();
+
+		this->culledCount = 0;
+		this->culledGroupCount = 0;
+
+		this->viewMatrix = viewMatrix;
+		this->frustum = frustum;
+		this->lights = &lights;
+	}
+
+	// The model matrix is referenced like in the render queue.
+	void Add(const GLSharedPtr<GLMeshRenderer>& renderer, const glm::mat4& modelMatrix)
+	{
+		glm::vec3 center;
+		float radius;
+
+		renderer->GetWorldSphere(modelMatrix, center, radius);
+
+		GLRecordedDraw draw;
+		draw.Renderer = renderer.get();
+		draw.Model = &modelMatrix;
+		draw.Depth = -(this->viewMatrix * glm::vec4(center, 1.0f)).z;
+		draw.bInstanceable = renderer->IsInstanceable();
+		draw.bCullFace = renderer->DoCullFace() && !renderer->GetMesh()->IsDoubleSided();
+
+		this->draws.push_back(draw);
+
+		this->centerX.push_back(center.x);
+		this->centerY.push_back(center.y);
+		this->centerZ.push_back(center.z);
+		this->radii.push_back(radius);
+
+		if (!this->openGroups.empty())
+		{
+			auto& group = this->groups[this->openGroups.back()];
+
+			group.Min = glm::min(group.Min, center - glm::vec3(radius));
+			group.Max = glm::max(group.Max, center + glm::vec3(radius));
+		}
+	}
+
+	// Draws added until the matching EndGroup belong to one subtree, which is culled as a whole
+	// when its bounds are outside the frustum. Groups nest.
+	void BeginGroup()
+	{
+		GLDrawGroup group;
+		group.First = (uint32_t)this->draws.size();
+
+		this->openGroups.push_back((uint32_t)this->groups.size());
+		this->groups.push_back(group);
+	}
+
+	void EndGroup()
+	{
+		assert(!this->openGroups.empty());
+
+		uint32_t index = this->openGroups.back();
+		this->openGroups.pop_back();
+
+		auto& group = this->groups[index];
+		group.DrawCount = (uint32_t)this->draws.size() - group.First;
+		group.GroupCount = (uint32_t)this->groups.size() - index - 1;
+
+		if (!this->openGroups.empty())
+		{
+			auto& parent = this->groups[this->openGroups.back()];
+
+			parent.Min = glm::min(parent.Min, group.Min);
+			parent.Max = glm::max(parent.Max, group.Max);
+		}
+	}
+
+	// Drops the draws outside the frustum and picks the lights of the rest. Called once recording
+	// is done, by a job as well.
+	void End()
+	{
+		assert(this->openGroups.empty());
+
+		if (this->frustum != nullptr)
+		{
+			this->Cull();
+		}
+
+		size_t count = 0;
+
+		for (size_t i = 0; i < this->draws.size(); ++i)
+		{
+			if (this->frustum != nullptr && this->visibility[i] == 0)
+			{
+				continue;
+			}
+
+			auto& draw = this->draws[count++];
+			draw = this->draws[i];
+
+			if (draw.Renderer->IsLightListDraw())
+			{
+				draw.Lights = (int)this->lightSelections.size();
+
+				glm::vec3 center(this->centerX[i], this->centerY[i], this->centerZ[i]);
+
+				this->lightSelections.emplace_back();
+				this->lights->Select(center, this->radii[i], GLMeshRenderer::GetLightListSize(), this->lightSelections.back());
+			}
+		}
+
+		this->culledCount = this->draws.size() - count;
+		this->draws.resize(count);
+	}
+
+	const std::vector<GLRecordedDraw>& GetDraws() const
+	{
+		return this->draws;
+	}
+
+	const GLLightSelection& GetLightSelection(int index) const
+	{
+		return this->lightSelections[index];
+	}
+
+	// Draws dropped by End, and the subtrees among them culled by their bounds alone.
+	size_t GetCulledCount() const
+	{
+		return this->culledCount;
+	}
+
+	size_t GetCulledGroupCount() const
+	{
+		return this->culledGroupCount;
+	}
+
+private:
+	// Subtree of recorded draws, the groups inside it follow it directly.
+	struct GLDrawGroup
+	{
+		uint32_t First = 0;
+		uint32_t DrawCount = 0;
+		uint32_t GroupCount = 0;
+
+		glm::vec3 Min = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 Max = glm::vec3(-std::numeric_limits<float>::max());
+	};
+
+	// Groups entirely outside or inside the frustum decide all their draws and skip the groups
+	// inside them, the remaining draws are tested four bounding spheres at a time.
+	void Cull()
+	{
+		const uint8_t UNDECIDED = 2;
+
+		size_t count = this->draws.size();
+
+		this->visibility.assign(count, UNDECIDED);
+
+		size_t index = 0;
+
+		while (index < this->groups.size())
+		{
+			const auto& group = this->groups[index];
+
+			if (group.DrawCount == 0)
+			{
+				index += 1 + group.GroupCount;
+				continue;
+			}
+
+			GLFrustumTest test = this->frustum->TestBox(group.Min, group.Max);
+
+			if (test == GLFrustumTest::Intersects)
+			{
+				++index;
+				continue;
+			}
+
+			auto first = this->visibility.begin() + group.First;
+			std::fill(first, first + group.DrawCount, test == GLFrustumTest::Inside ? 1 : 0);
+
+			if (test == GLFrustumTest::Outside)
+			{
+				this->culledGroupCount++;
+			}
+
+			index += 1 + group.GroupCount;
+		}
+
+		// Padding lanes are never read back.
+		size_t padded = (count + 3) & ~(size_t)3;
+
+		this->centerX.resize(padded);
+		this->centerY.resize(padded);
+		this->centerZ.resize(padded);
+		this->radii.resize(padded);
+
+		for (size_t i = 0; i < count; i += 4)
+		{
+			size_t lanes = std::min(count - i, (size_t)4);
+			bool bUndecided = false;
+
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				bUndecided |= this->visibility[i + lane] == UNDECIDED;
+			}
+
+			if (!bUndecided)
+			{
+				continue;
+			}
+
+			int mask = this->frustum->TestSpheres4(&this->centerX[i], &this->centerY[i], &this->centerZ[i], &this->radii[i]);
+
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				if (this->visibility[i + lane] == UNDECIDED)
+				{
+					this->visibility[i + lane] = (mask >> lane) & 1;
+				}
+			}
+		}
+	}
+
+	std::vector<GLRecordedDraw> draws;
+	std::vector<GLLightSelection> lightSelections;
+
+	// World bounding spheres of the draws as structure of arrays.
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radii;
+
+	std::vector<GLDrawGroup> groups;
+	std::vector<uint32_t> openGroups;
+
+	// Per recorded draw, 1 if visible.
+	std::vector<uint8_t> visibility;
+
+	size_t culledCount = 0;
+	size_t culledGroupCount = 0;
+
+	glm::mat4 viewMatrix;
+	const GLFrustum* frustum = nullptr;
+	const GLLightBuffer* lights = nullptr;
+};
\ No newline at end of file
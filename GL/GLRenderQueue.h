@@ -0,0 +1,544 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <gl/glew.h>
+#include <gl/glm/glm.hpp>
+
+#include "GLMemoryHelpers.h"
+#include "GLMeshRenderer.h"
+#include "GLLightBuffer.h"
+#include "GLInstanceBuffer.h"
+#include "GLGeometryPool.h"
+#include "GLDrawCommandBuffer.h"
+#include "GLRenderCommandBuffer.h"
+#include "GLJobSystem.h"
+#include "GLStateCache.h"
+
+// One mesh renderer drawn by a camera this frame.
+struct GLDrawItem
+{
+	uint64_t Key = 0;
+
+	GLMeshRenderer* Renderer = nullptr;
+	const glm::mat4* Model = nullptr;
+
+	// Lights picked when the draw was recorded, only set for light list draws.
+	const GLLightSelection* Lights = nullptr;
+
+	// View space depth of the bounding sphere center.
+	float Depth = 0.0f;
+
+	unsigned int Program = 0;
+	unsigned int Material = 0;
+	unsigned int Texture = 0;
+	unsigned int Sampler = 0;
+	unsigned int Mesh = 0;
+
+	// Whether the renderer can be drawn as an instance and which other items it can share a draw with.
+	bool bInstanceable = false;
+	bool bCullFace = false;
+};
+
+// How often consecutive draws switch program, material, texture or mesh.
+struct GLRenderStateChanges
+{
+	size_t Programs = 0;
+	size_t Materials = 0;
+	size_t Textures = 0;
+	size_t Meshes = 0;
+};
+
+// Counts of the last sorted frame, in traversal order and in submission order.
+struct GLRenderQueueStats
+{
+	// Items drawn, and those left out by frustum culling, the subtrees among them culled as a whole.
+	size_t Items = 0;
+	size_t Culled = 0;
+	size_t CulledSubtrees = 0;
+
+	// Draw calls per pass after instancing, the items drawn as instances and by multi-draw calls.
+	size_t Draws = 0;
+	size_t InstancedItems = 0;
+	size_t MultiDrawItems = 0;
+
+	GLRenderStateChanges Unsorted;
+	GLRenderStateChanges Sorted;
+};
+
+// Draws of one camera, recorded from the scene tree by parallel jobs and sorted before they are submitted.
+// Sort keys, most significant bits first:
+//   opaque       0 | program 12 | material 12 | texture 9 | no culling 1 | mesh 13 | depth 16, front to back
+//   transparent  1 | depth 16, back to front | program 12 | material 12 | texture 10 | mesh 13
+// Ids are truncated to their fields, equal truncated ids only cost an extra state change.
+// Instanceable items with plain color or texture array materials get material 0, their colors and
+// array layers go with the instance, so runs of the same mesh, program, texture and sampler become
+// a single instanced draw.
+// With multi-draw indirect, runs of instanceable items sharing program, material, texture, sampler
+// and culling become a single multi-draw call whatever their meshes, drawn from the shared geometry pool.
+class GLRenderQueue
+{
+public:
+	// Shorter runs are drawn one by one.
+	static const size_t MIN_INSTANCE_COUNT = 2;
+
+	// Fewest instances a job of the instance data fill takes.
+	static const int MIN_INSTANCE_JOB_SIZE = 256;
+
+	// Multi-draw indirect is used where the driver supports it, otherwise draws are instanced or plain.
+	static void SetMultiDrawIndirect(bool bEnabled)
+	{
+		bMultiDrawIndirect = bEnabled;
+	}
+
+	static bool IsMultiDrawIndirect()
+	{
+		return bMultiDrawIndirect && GLDrawCommandBuffer::IsSupported();
+	}
+
+	// Vertices of every mesh drawn by multi-draw calls, shared by all queues.
+	static const GLSharedPtr<GLGeometryPool>& GetGeometryPool()
+	{
+		if (geometryPool == nullptr)
+		{
+			geometryPool = GLCreate<GLGeometryPool>();
+		}
+
+		return geometryPool;
+	}
+
+	// Starts collecting the draws of a camera with these matrices.
+	void Begin(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const GLLightBuffer& lights)
+	{
+		this->items.clear();
+
+		this->stats.Culled = 0;
+		this->stats.CulledSubtrees = 0;
+
+		this->viewMatrix = viewMatrix;
+		this->projectionMatrix = projectionMatrix;
+		this->lights = &lights;
+	}
+
+	// Merges the draws recorded into a command buffer, keeping the order of the calls. Variants
+	// are selected here on the GL thread, selecting one may compile its program.
+	void Add(const GLRenderCommandBuffer& commands)
+	{
+		this->stats.Culled += commands.GetCulledCount();
+		this->stats.CulledSubtrees += commands.GetCulledGroupCount();
+
+		for (const auto& draw : commands.GetDraws())
+		{
+			auto renderer = draw.Renderer;
+
+			// Keys use the program of the variant the renderer will draw with.
+			renderer->SelectVariant(*this->lights);
+
+			const auto& material = renderer->GetMaterial();
+
+			GLDrawItem item;
+			item.Renderer = renderer;
+			item.Model = draw.Model;
+			item.Lights = draw.Lights >= 0 ? &commands.GetLightSelection(draw.Lights) : nullptr;
+			item.Depth = draw.Depth;
+			item.Program = material->GetShader()->GetId();
+			item.Material = material->GetSortId();
+			item.Texture = material->GetTextureId();
+			item.Sampler = material->GetSamplerId();
+			item.Mesh = renderer->GetMesh()->GetSortId();
+			item.bInstanceable = draw.bInstanceable;
+			item.bCullFace = draw.bCullFace;
+
+			auto diffuseSource = material->GetDiffuseSource();
+
+			if (item.bInstanceable && (diffuseSource == GLDiffuseSource::Color || diffuseSource == GLDiffuseSource::MapArray))
+			{
+				item.Material = 0;
+			}
+
+			item.Key = GetKey(item, renderer->DoBlend());
+
+			this->items.push_back(item);
+		}
+	}
+
+	void Sort()
+	{
+		this->order.resize(this->items.size());
+
+		for (size_t i = 0; i < this->items.size(); ++i)
+		{
+			this->order[i] = { this->items[i].Key, (uint32_t)i };
+		}
+
+		this->stats.Items = this->items.size();
+		this->stats.Unsorted = this->CountStateChanges();
+
+		this->RadixSort();
+
+		this->stats.Sorted = this->CountStateChanges();
+
+		this->BuildBatches();
+	}
+
+	// Draws the sorted items, once per render pass. Transparent items come last and do not write depth.
+	void Submit()
+	{
+		bool bDepthMask = GLStateCache::GetDepthMask();
+
+		if (!this->commands.empty())
+		{
+			this->instanceBuffer.BindStorage((GLuint)GLStorageBlockBinding::Draws);
+		}
+
+		bool bTransparent = false;
+
+		for (const auto& batch : this->batches)
+		{
+			const auto& entry = this->order[batch.First];
+			const auto& item = this->items[entry.Index];
+
+			if (!bTransparent && (entry.Key & TRANSPARENT_BIT) != 0)
+			{
+				GLStateCache::SetDepthMask(false);
+				bTransparent = true;
+			}
+
+			if (batch.Instance < 0)
+			{
+				item.Renderer->Render(*item.Model, this->viewMatrix, this->projectionMatrix, *this->lights, item.Lights);
+				continue;
+			}
+
+			for (size_t i = batch.First; i < batch.First + batch.Count; ++i)
+			{
+				const auto& instance = this->items[this->order[i].Index];
+
+				instance.Renderer->RequestDetail(*instance.Model, this->viewMatrix, this->projectionMatrix);
+			}
+
+			if (batch.Command >= 0)
+			{
+				item.Renderer->RenderMultiDraw(*GetGeometryPool(), this->commandBuffer, batch.Command, (GLsizei)batch.Count, batch.Instance, *this->lights);
+				continue;
+			}
+
+			item.Renderer->RenderInstances(this->instanceBuffer, batch.Instance, (GLsizei)batch.Count, *this->lights);
+		}
+
+		GLStateCache::SetDepthMask(bDepthMask);
+	}
+
+	size_t GetItemCount()
+	{
+		return this->items.size();
+	}
+
+	const GLRenderQueueStats& GetStats()
+	{
+		return this->stats;
+	}
+
+private:
+	static const uint64_t TRANSPARENT_BIT = 1ull << 63;
+
+	struct GLSortEntry
+	{
+		uint64_t Key;
+		uint32_t Index;
+	};
+
+	// Sorted entries drawn with one call, instanced from Instance on or, below 0, a single item.
+	// Multi-draw batches draw the commands from Command on, reading their data from Instance on.
+	struct GLDrawBatch
+	{
+		size_t First;
+		size_t Count;
+		GLsizei Instance;
+		GLsizei Command = -1;
+	};
+
+	static uint64_t GetKey(const GLDrawItem& item, bool bTransparent)
+	{
+		uint64_t program = item.Program & 0xFFF;
+		// Items sharing material 0 are kept apart by sampler, which they still have to agree on.
+		uint64_t material = (item.Material != 0 ? item.Material : item.Sampler) & 0xFFF;
+		uint64_t texture = item.Texture & 0x3FF;
+		uint64_t mesh = item.Mesh & 0x1FFF;
+		uint64_t depth = GetDepthKey(item.Depth);
+
+		if (bTransparent)
+		{
+			return TRANSPARENT_BIT | ((0xFFFF - depth) << 47) | (program << 35) | (material << 23) | (texture << 13) | mesh;
+		}
+
+		// Culled and double sided meshes apart, so neither breaks up the runs of the other.
+		uint64_t noCulling = item.bCullFace ? 0 : 1;
+
+		return (program << 51) | (material << 39) | ((texture & 0x1FF) << 30) | (noCulling << 29) | (mesh << 16) | depth;
+	}
+
+	// The bits of a positive float sort like the float, the upper 16 keep about two decimal digits.
+	static uint64_t GetDepthKey(float depth)
+	{
+		depth = glm::max(depth, 0.0f);
+
+		uint32_t bits;
+		std::memcpy(&bits, &depth, sizeof(bits));
+
+		return bits >> 16;
+	}
+
+	// Stable LSD radix sort by bytes. Bytes equal in every key, common in the upper id fields,
+	// are skipped, all histograms come from one pass over the keys.
+	void RadixSort()
+	{
+		size_t count = this->order.size();
+
+		if (count < 2)
+		{
+			return;
+		}
+
+		size_t histograms[8][256] = {};
+
+		for (const auto& entry : this->order)
+		{
+			for (int digit = 0; digit < 8; ++digit)
+			{
+				histograms[digit][(entry.Key >> (digit * 8)) & 0xFF]++;
+			}
+		}
+
+		this->scratch.resize(count);
+
+		for (int digit = 0; digit < 8; ++digit)
+		{
+			int shift = digit * 8;
+			size_t* histogram = histograms[digit];
+
+			if (histogram[(this->order[0].Key >> shift) & 0xFF] == count)
+			{
+				continue;
+			}
+
+			size_t offsets[256];
+			size_t offset = 0;
+
+			for (int i = 0; i < 256; ++i)
+			{
+				offsets[i] = offset;
+				offset += histogram[i];
+			}
+
+			for (const auto& entry : this->order)
+			{
+				this->scratch[offsets[(entry.Key >> shift) & 0xFF]++] = entry;
+			}
+
+			this->order.swap(this->scratch);
+		}
+	}
+
+	static bool CanShareDraw(const GLDrawItem& first, const GLDrawItem& item)
+	{
+		return item.bInstanceable && item.Mesh == first.Mesh && item.Program == first.Program && item.Material == first.Material &&
+			item.Texture == first.Texture && item.Sampler == first.Sampler && item.bCullFace == first.bCullFace;
+	}
+
+	static bool CanShareMultiDraw(const GLDrawItem& first, const GLDrawItem& item)
+	{
+		return item.bInstanceable && item.Program == first.Program && item.Material == first.Material && item.Texture == first.Texture &&
+			item.Sampler == first.Sampler && item.bCullFace == first.bCullFace && item.Renderer->GetMesh()->GetDrawMode() == first.Renderer->GetMesh()->GetDrawMode();
+	}
+
+	// Pool ranges of the meshes of instanceable items. Emptying the pool on the way invalidates the
+	// ranges prepared before, so that round is repeated, with the pool then having room for all.
+	void PrepareGeometry()
+	{
+		const auto& pool = GetGeometryPool();
+
+		this->ranges.resize(this->items.size());
+
+		unsigned int generation = 0;
+
+		do
+		{
+			generation = pool->GetGeneration();
+
+			for (size_t i = 0; i < this->items.size(); ++i)
+			{
+				if (this->items[i].bInstanceable)
+				{
+					this->ranges[i] = pool->Prepare(*this->items[i].Renderer->GetMesh());
+				}
+			}
+		}
+		while (generation != pool->GetGeneration());
+	}
+
+	// Groups runs of items sharing mesh, program and material kind, and uploads their instances.
+	// With multi-draw indirect the runs only need to share program and material kind, every item
+	// gets a command and an entry in the instance buffer. The instance data is filled by jobs.
+	void BuildBatches()
+	{
+		this->batches.clear();
+		this->instanceItems.clear();
+		this->commands.clear();
+
+		this->stats.InstancedItems = 0;
+		this->stats.MultiDrawItems = 0;
+
+		bool bMultiDraw = IsMultiDrawIndirect();
+
+		if (bMultiDraw)
+		{
+			this->PrepareGeometry();
+		}
+
+		size_t count = this->order.size();
+		size_t first = 0;
+
+		while (first < count)
+		{
+			const auto& item = this->items[this->order[first].Index];
+			size_t last = first + 1;
+
+			if (bMultiDraw && item.bInstanceable)
+			{
+				while (last < count && CanShareMultiDraw(item, this->items[this->order[last].Index]))
+				{
+					++last;
+				}
+
+				this->batches.push_back({ first, last - first, (GLsizei)this->instanceItems.size(), (GLsizei)this->commands.size() });
+
+				for (size_t i = first; i < last; ++i)
+				{
+					const auto& range = this->ranges[this->order[i].Index];
+
+					GLDrawArraysCommand command;
+					command.Count = range.Count;
+					command.First = range.First;
+
+					this->commands.push_back(command);
+					this->instanceItems.push_back(this->order[i].Index);
+				}
+
+				this->stats.MultiDrawItems += last - first;
+				first = last;
+				continue;
+			}
+
+			if (item.bInstanceable)
+			{
+				while (last < count && CanShareDraw(item, this->items[this->order[last].Index]))
+				{
+					++last;
+				}
+			}
+
+			if (last - first < MIN_INSTANCE_COUNT)
+			{
+				for (size_t i = first; i < last; ++i)
+				{
+					this->batches.push_back({ i, 1, -1 });
+				}
+
+				first = last;
+				continue;
+			}
+
+			this->batches.push_back({ first, last - first, (GLsizei)this->instanceItems.size() });
+
+			for (size_t i = first; i < last; ++i)
+			{
+				this->instanceItems.push_back(this->order[i].Index);
+			}
+
+			this->stats.InstancedItems += last - first;
+			first = last;
+		}
+
+		this->stats.Draws = this->batches.size();
+
+		this->FillInstances();
+
+		if (!this->instances.empty())
+		{
+			this->instanceBuffer.Update(this->instances);
+		}
+
+		if (!this->commands.empty())
+		{
+			this->commandBuffer.Update(this->commands);
+		}
+	}
+
+	// Model matrices and colors of the instanced items, in the order of instanceItems.
+	void FillInstances()
+	{
+		this->instances.resize(this->instanceItems.size());
+
+		GLJobSystem::ParallelFor((int)this->instances.size(), MIN_INSTANCE_JOB_SIZE,
+			[this](int begin, int end, int /*worker*/)
+			{
+				for (int i = begin; i < end; ++i)
+				{
+					const auto& item = this->items[this->instanceItems[i]];
+					auto& data = this->instances[i];
+
+					data.Model = *item.Model;
+					item.Renderer->GetMaterial()->GetInstanceColors(data.Diffuse, data.Specular);
+				}
+			}
+		);
+	}
+
+	GLRenderStateChanges CountStateChanges()
+	{
+		GLRenderStateChanges changes;
+		const GLDrawItem* previous = nullptr;
+
+		for (const auto& entry : this->order)
+		{
+			const auto& item = this->items[entry.Index];
+
+			changes.Programs += previous == nullptr || previous->Program != item.Program;
+			changes.Materials += previous == nullptr || previous->Material != item.Material;
+			changes.Textures += previous == nullptr || previous->Texture != item.Texture;
+			changes.Meshes += previous == nullptr || previous->Mesh != item.Mesh;
+
+			previous = &item;
+		}
+
+		return changes;
+	}
+
+	std::vector<GLDrawItem> items;
+	std::vector<GLSortEntry> order;
+	std::vector<GLSortEntry> scratch;
+
+	std::vector<GLDrawBatch> batches;
+	std::vector<uint32_t> instanceItems;
+	std::vector<GLInstanceData> instances;
+	GLInstanceBuffer instanceBuffer;
+
+	std::vector<GLGeometryRange> ranges;
+	std::vector<GLDrawArraysCommand> commands;
+	GLDrawCommandBuffer commandBuffer;
+
+	glm::mat4 viewMatrix;
+	glm::mat4 projectionMatrix;
+	const GLLightBuffer* lights = nullptr;
+
+	GLRenderQueueStats stats;
+
+	static bool bMultiDrawIndirect;
+	static GLSharedPtr<GLGeometryPool> geometryPool;
+};
+
+bool GLRenderQueue::bMultiDrawIndirect = true;
+GLSharedPtr<GLGeometryPool> GLRenderQueue::geometryPool = nullptr;
\ No newline at end of file
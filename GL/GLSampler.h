@@ -0,0 +1,148 @@
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+
+#include <gl/glew.h>
+
+#include "GLMemoryHelpers.h"
+#include "GLTextureBinder.h"
+
+struct GLSamplerDesc
+{
+	GLSamplerDesc() { }
+
+	GLSamplerDesc(GLenum minFilter, GLenum magFilter, GLenum wrap = GL_REPEAT, float anisotropy = 1.0f)
+		: MinFilter(minFilter), MagFilter(magFilter), WrapS(wrap), WrapT(wrap), Anisotropy(anisotropy) { }
+
+	bool operator==(const GLSamplerDesc& other) const
+	{
+		return this->MinFilter == other.MinFilter && this->MagFilter == other.MagFilter &&
+			this->WrapS == other.WrapS && this->WrapT == other.WrapT && this->Anisotropy == other.Anisotropy;
+	}
+
+	static GLSamplerDesc Point()
+	{
+		return GLSamplerDesc(GL_NEAREST, GL_NEAREST);
+	}
+
+	static GLSamplerDesc Bilinear()
+	{
+		return GLSamplerDesc(GL_LINEAR_MIPMAP_NEAREST, GL_LINEAR);
+	}
+
+	static GLSamplerDesc Trilinear()
+	{
+		return GLSamplerDesc(GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+	}
+
+	static GLSamplerDesc Anisotropic(float anisotropy)
+	{
+		return GLSamplerDesc(GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, anisotropy);
+	}
+
+	GLenum MinFilter = GL_LINEAR_MIPMAP_LINEAR;
+	GLenum MagFilter = GL_LINEAR;
+	GLenum WrapS = GL_REPEAT;
+	GLenum WrapT = GL_REPEAT;
+	float Anisotropy = 1.0f;
+};
+
+struct GLSamplerDescHash
+{
+	size_t operator()(const GLSamplerDesc& desc) const
+	{
+		size_t hash = std::hash<unsigned int>()(desc.MinFilter);
+		hash = hash * 31 + std::hash<unsigned int>()(desc.MagFilter);
+		hash = hash * 31 + std::hash<unsigned int>()(desc.WrapS);
+		hash = hash * 31 + std::hash<unsigned int>()(desc.WrapT);
+		hash = hash * 31 + std::hash<float>()(desc.Anisotropy);
+
+		return hash;
+	}
+};
+
+class GLSampler
+{
+public:
+	GLSampler(const GLSamplerDesc& desc)
+		: desc(desc)
+	{
+		glGenSamplers(1, &this->id);
+
+		glSamplerParameteri(this->id, GL_TEXTURE_MIN_FILTER, desc.MinFilter);
+		glSamplerParameteri(this->id, GL_TEXTURE_MAG_FILTER, desc.MagFilter);
+		glSamplerParameteri(this->id, GL_TEXTURE_WRAP_S, desc.WrapS);
+		glSamplerParameteri(this->id, GL_TEXTURE_WRAP_T, desc.WrapT);
+
+		if (desc.Anisotropy > 1.0f && GLEW_EXT_texture_filter_anisotropic)
+		{
+			float maxAnisotropy = 1.0f;
+			glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+
+			glSamplerParameterf(this->id, GL_TEXTURE_MAX_ANISOTROPY_EXT, desc.Anisotropy < maxAnisotropy ? desc.Anisotropy : maxAnisotropy);
+		}
+	}
+
+	virtual ~GLSampler()
+	{
+		glDeleteSamplers(1, &this->id);
+		GLTextureBinder::ForgetSampler(this->id);
+	}
+
+	unsigned int GetId()
+	{
+		return this->id;
+	}
+
+	const GLSamplerDesc& GetDesc()
+	{
+		return this->desc;
+	}
+
+	void Use(int unit = 0)
+	{
+		GLTextureBinder::BindSampler(unit, this->id);
+	}
+
+private:
+	unsigned int id = -1;
+
+	GLSamplerDesc desc;
+};
+
+// Sampler objects are created once per filter, wrap and anisotropy combination and
+// shared by every material using it.
+class GLSamplerCache
+{
+public:
+	static GLSharedPtr<GLSampler> Get(const GLSamplerDesc& desc)
+	{
+		auto position = samplers.find(desc);
+
+		if (position != samplers.end())
+		{
+			return position->second;
+		}
+
+		auto sampler = GLCreate<GLSampler>(desc);
+		samplers[desc] = sampler;
+
+		return sampler;
+	}
+
+	static size_t GetSamplerCount()
+	{
+		return samplers.size();
+	}
+
+	static void Clear()
+	{
+		samplers.clear();
+	}
+
+private:
+	static std::unordered_map<GLSamplerDesc, GLSharedPtr<GLSampler>, GLSamplerDescHash> samplers;
+};
+
+std::unordered_map<GLSamplerDesc, GLSharedPtr<GLSampler>, GLSamplerDescHash> GLSamplerCache::samplers;
\ No newline at end of file
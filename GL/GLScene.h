@@ -18,11 +18,19 @@
 #include "GLGameObject.h"
 #include "GLCamera.h"
 #include "GLLight.h"
+#include "GLLightBuffer.h"
 #include "GLPhysics.h"
+#include "GLStaticBatcher.h"
+#include "GLRenderCommandBuffer.h"
+#include "GLJobSystem.h"
+#include "GLStateCache.h"
 
 class GLScene
 {
 public:
+	// Command buffers recorded per thread, more than one evens out subtrees of different sizes.
+	static const int RECORD_RUNS_PER_THREAD = 4;
+
 	GLScene(const std::string& name)
 		: name(name),
 		  background(1.0f, 1.0f, 1.0f)
@@ -31,6 +39,9 @@ public:
 		this->Root->SetScene(GLSharedPtr<GLScene>(this));
 
 		this->Physics = GLCreate<GLPhysics>();
+
+		this->lightBuffer = GLCreate<GLLightBuffer>();
+		this->staticBatcher = GLCreate<GLStaticBatcher>();
 	}
 
 	virtual ~GLScene() { }
@@ -54,23 +65,45 @@ public:
 		}
 	}
 
+	// Lights are sorted into typed lists once here, rendering never inspects their type.
 	void AddLight(const GLSharedPtr<GLLight>& light)
 	{
 		assert(light != nullptr);
 
-		this->Lights.push_back(light);
+		if (auto spotLight = std::dynamic_pointer_cast<GLSpotLight>(light))
+		{
+			this->spotLights.Add(spotLight);
+		}
+		else if (auto pointLight = std::dynamic_pointer_cast<GLPointLight>(light))
+		{
+			this->pointLights.Add(pointLight);
+		}
+		else if (auto directionalLight = std::dynamic_pointer_cast<GLDirectionalLight>(light))
+		{
+			this->directionalLights.Add(directionalLight);
+		}
 	}
 
 	void RemoveLight(const GLSharedPtr<GLLight>& light)
 	{
 		assert(light != nullptr);
 
-		auto position = std::find(this->Lights.begin(), this->Lights.end(), light);
+		this->directionalLights.Remove(light) || this->pointLights.Remove(light) || this->spotLights.Remove(light);
+	}
 
-		if (position != this->Lights.end())
-		{
-			this->Lights.erase(position);
-		}
+	const GLLightList<GLDirectionalLight>& GetDirectionalLights()
+	{
+		return this->directionalLights;
+	}
+
+	const GLLightList<GLPointLight>& GetPointLights()
+	{
+		return this->pointLights;
+	}
+
+	const GLLightList<GLSpotLight>& GetSpotLights()
+	{
+		return this->spotLights;
 	}
 
 	void Update(float deltaTime)
@@ -97,6 +130,20 @@ public:
 			}
 		);
 
+		// Lights are the same for every camera, unchanged lists are not repacked.
+		this->lightBuffer->Update(this->directionalLights);
+		this->lightBuffer->Update(this->pointLights);
+		this->lightBuffer->Update(this->spotLights);
+		this->lightBuffer->Bind();
+
+		// Light lists index every point and spot light in the light data buffer.
+		if (GLMeshRenderer::GetLightListSize() > 0)
+		{
+			this->lightBuffer->BindLightData();
+		}
+
+		this->staticBatcher->Update(this->Root);
+
 		for (const auto& camera : this->Cameras)
 		{
 			if (camera->IsActive())
@@ -112,17 +159,87 @@ public:
 				int width = cameraViewportSize.x * windowSize.x;
 				int height = cameraViewportSize.y * windowSize.y;
 
-				glViewport(x, y, width, height);
+				GLStateCache::SetViewport(x, y, width, height);
 				glClear(GL_DEPTH_BUFFER_BIT);
 
-				glm::vec3 cameraPosition = camera->GetTransform()->GetPosition();
+				if (camera->IsClusteredLighting())
+				{
+					camera->UpdateLightClusters(*this->lightBuffer);
+				}
+
+				camera->BindUniforms(glm::vec4(x, y, width, height));
+
+				GLMeshRenderer::SetViewportHeight((float)height);
+				GLMeshRenderer::SetClusteredLighting(camera->IsClusteredLighting());
+
+				bool bDeferred = camera->GetRenderPath() == GLRenderPath::Deferred;
+				bool bDepthPrePass = !bDeferred && camera->IsDepthPrePass();
+
+				// The tree is walked once per camera, every pass draws the sorted queue. Sorting
+				// front to back relies on depth testing, ties keep the traversal order.
+				const auto& renderQueue = camera->GetRenderQueue();
+
+				GLMeshRenderer::SetRenderPass(bDeferred ? GLRenderPass::GBuffer : GLRenderPass::Forward);
+
+				renderQueue->Begin(camera->GetCachedViewMatrix(), camera->GetCachedProjectionMatrix(), *this->lightBuffer);
+				this->Record(camera, *renderQueue);
+				renderQueue->Sort();
+
+				GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+				GLStateCache::SetDepthFunc(GL_LEQUAL);
+
+				if (bDeferred)
+				{
+					const auto& deferredRenderer = camera->GetDeferredRenderer();
+
+					deferredRenderer->BeginGeometry(windowSize);
+
+					renderQueue->Submit();
 
-				this->Root->Render(camera->GetLayer(), camera->GetCachedViewMatrix(), camera->GetCachedProjectionMatrix(), cameraPosition, this->Lights);
-				this->Physics->Render(camera->GetCachedViewMatrix(), camera->GetCachedProjectionMatrix(), cameraPosition);
+					deferredRenderer->EndGeometry();
+					deferredRenderer->RenderLights(*this->lightBuffer);
+
+					GLMeshRenderer::SetRenderPass(GLRenderPass::ForwardFallback);
+				}
+				else if (bDepthPrePass)
+				{
+					const auto& depthPrePass = camera->GetDepthPrePass();
+
+					depthPrePass->BeginDepth();
+
+					GLMeshRenderer::SetRenderPass(GLRenderPass::DepthPrePass);
+					renderQueue->Submit();
+
+					depthPrePass->BeginColor();
+
+					GLMeshRenderer::SetRenderPass(GLRenderPass::Opaque);
+					renderQueue->Submit();
+
+					depthPrePass->EndColor();
+
+					GLMeshRenderer::SetRenderPass(GLRenderPass::ForwardFallback);
+				}
+
+				renderQueue->Submit();
+
+				if (bDepthPrePass)
+				{
+					camera->GetDepthPrePass()->End();
+				}
+
+				GLStateCache::SetEnabled(GL_DEPTH_TEST, false);
+
+				GLMeshRenderer::SetRenderPass(GLRenderPass::Forward);
+				this->Physics->Render();
 			}
 		}
 	}
 
+	const GLSharedPtr<GLStaticBatcher>& GetStaticBatcher()
+	{
+		return this->staticBatcher;
+	}
+
 	void SetBackgroundColor(const GLColor& color)
 	{
 		this->background = color;
@@ -136,12 +253,52 @@ public:
 	GLSharedPtr<GLPhysics> Physics;
 	GLSharedPtr<GLGameObject> Root;
 	std::vector<GLSharedPtr<GCamera>> Cameras;
-	std::vector<GLSharedPtr<GLLight>> Lights;
 
 protected:
+	// Subtrees of the root are recorded and culled by parallel jobs, the command buffers are merged
+	// into the queue in traversal order on this thread.
+	void Record(const GLSharedPtr<GCamera>& camera, GLRenderQueue& renderQueue)
+	{
+		const GLFrustum* frustum = camera->IsFrustumCulling() ? &camera->GetFrustum() : nullptr;
+
+		this->commandBuffers.resize(GLJobSystem::GetThreadCount() * RECORD_RUNS_PER_THREAD + 1);
+
+		for (auto& commands : this->commandBuffers)
+		{
+			commands.Begin(camera->GetCachedViewMatrix(), frustum, *this->lightBuffer);
+		}
+
+		this->Root->EnqueueParallel(camera->GetLayer(), this->commandBuffers);
+		this->staticBatcher->Enqueue(camera->GetLayer(), this->commandBuffers.back());
+
+		GLJobSystem::ParallelFor((int)this->commandBuffers.size(), 1,
+			[this](int begin, int end, int /*worker*/)
+			{
+				for (int i = begin; i < end; ++i)
+				{
+					this->commandBuffers[i].End();
+				}
+			}
+		);
+
+		for (const auto& commands : this->commandBuffers)
+		{
+			renderQueue.Add(commands);
+		}
+	}
+
 	std::string name;
 	GLColor background;
 
+	GLLightList<GLDirectionalLight> directionalLights;
+	GLLightList<GLPointLight> pointLights;
+	GLLightList<GLSpotLight> spotLights;
+
+	GLSharedPtr<GLLightBuffer> lightBuffer = nullptr;
+	GLSharedPtr<GLStaticBatcher> staticBatcher = nullptr;
+
+	std::vector<GLRenderCommandBuffer> commandBuffers;
+
 	float fixedTimeStep = 0.02f;
 	float timeStepAccumulator = 0.0f;
 };
\ No newline at end of file
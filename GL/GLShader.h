@@ -4,6 +4,10 @@
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include <unordered_map>
 
 #include <gl/glew.h>
@@ -11,6 +15,7 @@
 #include <gl/glm/gtc/type_ptr.hpp>
 
 #include "GLMemoryHelpers.h"
+#include "GLStateCache.h"
 
 class GLShaderLoader
 {
@@ -147,6 +152,252 @@ public:
 	}
 };
 
+// FNV-1a, usable at compile time so uniform names in the hot path are never hashed per draw.
+constexpr uint32_t GLHashName(const char* name, uint32_t hash = 2166136261u)
+{
+	while (*name != '\0')
+	{
+		hash = (hash ^ (unsigned char)*name++) * 16777619u;
+	}
+
+	return hash;
+}
+
+inline uint32_t GLHashName(const std::string& name)
+{
+	return GLHashName(name.c_str());
+}
+
+// Every uniform handle gets a slot, each program maps slots to its own uniform table once.
+class GLUniformSlots
+{
+public:
+	static int Allocate()
+	{
+		return count++;
+	}
+
+	static int GetCount()
+	{
+		return count;
+	}
+
+private:
+	static int count;
+};
+
+int GLUniformSlots::count = 0;
+
+// Program independent uniform reference. Meant to be created once, e.g. as a static member:
+// static const GLUniformHandle<glm::mat4> ModelUniform(GLHashName("model"));
+template <typename T>
+class GLUniformHandle
+{
+public:
+	explicit GLUniformHandle(uint32_t nameHash)
+		: nameHash(nameHash), slot(GLUniformSlots::Allocate()) { }
+
+	explicit GLUniformHandle(const std::string& name)
+		: GLUniformHandle(GLHashName(name)) { }
+
+	uint32_t GetNameHash() const
+	{
+		return this->nameHash;
+	}
+
+	int GetSlot() const
+	{
+		return this->slot;
+	}
+
+private:
+	uint32_t nameHash = 0;
+	int slot = -1;
+};
+
+struct GLUniformInfo
+{
+	std::string Name;
+	int Location = -1;
+	GLenum Type = 0;
+};
+
+// Binding points of the uniform blocks shared by the built-in shaders. Blocks with these names
+// are bound when a program is linked, so their buffers are bound once for every program.
+enum class GLUniformBlockBinding : unsigned int
+{
+	Camera = 0,
+	Lights = 1
+};
+
+// Binding points of the shader storage blocks of the built-in shaders, bound by name like the uniform blocks.
+enum class GLStorageBlockBinding : unsigned int
+{
+	Draws = 0
+};
+
+// Texture units of the buffers bound once per frame for the built-in shaders, above the units
+// used by materials.
+enum class GLTextureUnit : int
+{
+	GBufferAlbedo = 9,
+	GBufferNormal = 10,
+	GBufferSpecular = 11,
+	GBufferDepth = 12,
+	LightData = 13,
+	ClusterRanges = 14,
+	ClusterLightIndices = 15
+};
+
+struct GLUniformUploadStats
+{
+	size_t Issued = 0;
+	size_t Skipped = 0;
+};
+
+struct GLUniformBlockInfo
+{
+	std::string Name;
+	unsigned int Index = GL_INVALID_INDEX;
+	int DataSize = 0;
+	int Binding = 0;
+};
+
+// Index into the uniform table of one program. Resolve once with GLShader::GetUniform and keep it.
+template <typename T>
+struct GLUniform
+{
+	int Index = -1;
+
+	bool IsValid() const
+	{
+		return this->Index >= 0;
+	}
+};
+
+// Which reflected GL types a C++ value type can be uploaded to.
+template <typename T>
+struct GLUniformType
+{
+	static bool Accepts(GLenum type)
+	{
+		return false;
+	}
+};
+
+template <>
+struct GLUniformType<int>
+{
+	static bool Accepts(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_INT:
+		case GL_BOOL:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_2D_SHADOW:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_BUFFER:
+		case GL_INT_SAMPLER_BUFFER:
+		case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+			return true;
+		default:
+			return false;
+		}
+	}
+};
+
+template <>
+struct GLUniformType<unsigned int>
+{
+	static bool Accepts(GLenum type)
+	{
+		return type == GL_UNSIGNED_INT || type == GL_BOOL;
+	}
+};
+
+template <>
+struct GLUniformType<glm::tvec2<int>>
+{
+	static bool Accepts(GLenum type)
+	{
+		return type == GL_INT_VEC2 || type == GL_BOOL_VEC2;
+	}
+};
+
+template <>
+struct GLUniformType<glm::tvec3<int>>
+{
+	static bool Accepts(GLenum type)
+	{
+		return type == GL_INT_VEC3 || type == GL_BOOL_VEC3;
+	}
+};
+
+template <>
+struct GLUniformType<glm::tvec4<int>>
+{
+	static bool Accepts(GLenum type)
+	{
+		return type == GL_INT_VEC4 || type == GL_BOOL_VEC4;
+	}
+};
+
+template <>
+struct GLUniformType<GLfloat>
+{
+	static bool Accepts(GLenum type)
+	{
+		return type == GL_FLOAT;
+	}
+};
+
+template <>
+struct GLUniformType<glm::vec2>
+{
+	static bool Accepts(GLenum type)
+	{
+		return type == GL_FLOAT_VEC2;
+	}
+};
+
+template <>
+struct GLUniformType<glm::vec3>
+{
+	static bool Accepts(GLenum type)
+	{
+		return type == GL_FLOAT_VEC3;
+	}
+};
+
+template <>
+struct GLUniformType<glm::vec4>
+{
+	static bool Accepts(GLenum type)
+	{
+		return type == GL_FLOAT_VEC4;
+	}
+};
+
+template <>
+struct GLUniformType<glm::mat3>
+{
+	static bool Accepts(GLenum type)
+	{
+		return type == GL_FLOAT_MAT3;
+	}
+};
+
+template <>
+struct GLUniformType<glm::mat4>
+{
+	static bool Accepts(GLenum type)
+	{
+		return type == GL_FLOAT_MAT4;
+	}
+};
 
 class GLShader
 {
@@ -165,7 +416,7 @@ public:
 
 	virtual ~GLShader()
 	{
-		glDeleteProgram(this->Id);
+		this->Destroy();
 	}
 
 	void Load(const std::string& vertexFilename, const std::string& fragmentFilename)
@@ -176,28 +427,353 @@ public:
 		this->CreateProgram(vertexShaderLoader, fragmentShaderLoader);
 	}
 
+	void Compile(const std::string& vertexSource, const std::string& fragmentSource)
+	{
+		GLVertexShaderLoader vertexShaderLoader;
+		GLFragmentShaderLoader fragmentShaderLoader;
+
+		vertexShaderLoader.SetSource(vertexSource);
+		fragmentShaderLoader.SetSource(fragmentSource);
+
+		vertexShaderLoader.Load();
+		fragmentShaderLoader.Load();
+
+		this->CreateProgram(vertexShaderLoader, fragmentShaderLoader);
+	}
+
+	// Submits compile and link without querying their status, so the driver can work on it
+	// in the background. The program is finished by the first IsReady, Wait or Use.
+	void CompileAsync(const std::string& vertexSource, const std::string& fragmentSource)
+	{
+		const char* vertexCode = vertexSource.c_str();
+		const char* fragmentCode = fragmentSource.c_str();
+
+		this->Destroy();
+
+		this->vertexId = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(this->vertexId, 1, &vertexCode, NULL);
+		glCompileShader(this->vertexId);
+
+		this->fragmentId = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(this->fragmentId, 1, &fragmentCode, NULL);
+		glCompileShader(this->fragmentId);
+
+		this->Id = glCreateProgram();
+
+		if (this->bBinaryRetrievable)
+		{
+			glProgramParameteri(this->Id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+
+		glAttachShader(this->Id, this->vertexId);
+		glAttachShader(this->Id, this->fragmentId);
+		glLinkProgram(this->Id);
+
+		this->bPending = true;
+	}
+
+	bool IsPending()
+	{
+		return this->bPending;
+	}
+
+	// Never blocks when the driver supports parallel shader compile. Without it, the status
+	// cannot be polled and the program is finished right away.
+	bool IsReady()
+	{
+		if (!this->bPending)
+		{
+			return true;
+		}
+
+		if (IsParallelCompileSupported())
+		{
+			int completed = GL_FALSE;
+			glGetProgramiv(this->Id, GL_COMPLETION_STATUS_KHR, &completed);
+
+			if (!completed)
+			{
+				return false;
+			}
+		}
+
+		this->FinishCompile();
+
+		return true;
+	}
+
+	void Wait()
+	{
+		if (this->bPending)
+		{
+			this->FinishCompile();
+		}
+	}
+
+	GLSharedPtr<GLShader> GetFallback()
+	{
+		return this->fallback;
+	}
+
+	// Program bound instead of this one while it is still compiling.
+	void SetFallback(const GLSharedPtr<GLShader>& fallback)
+	{
+		this->fallback = fallback;
+	}
+
+	bool IsUsingFallback()
+	{
+		return this->bUsingFallback;
+	}
+
+	static bool IsParallelCompileSupported()
+	{
+		return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+	}
+
+	// Deletes the program right away, e.g. before the GL context goes away.
+	void Destroy()
+	{
+		if (this->Id != (unsigned int)-1)
+		{
+			glDeleteProgram(this->Id);
+			GLStateCache::ForgetProgram(this->Id);
+			this->Id = -1;
+		}
+
+		this->DeleteStages();
+
+		this->bPending = false;
+		this->bUsingFallback = false;
+
+		this->uniforms.clear();
+		this->uniformHashes.clear();
+		this->uniformBlocks.clear();
+		this->slotIndices.clear();
+		this->locationIndices.clear();
+		this->shadows.clear();
+		this->shadowValues.clear();
+	}
+
 	unsigned int GetId()
 	{
 		return this->Id;
 	}
 
+	// Asks the driver to keep the linked binary around for GetBinary. Must be set before linking.
+	void SetBinaryRetrievable(bool retrievable)
+	{
+		this->bBinaryRetrievable = retrievable;
+	}
+
+	bool GetBinary(GLenum& format, std::vector<char>& data)
+	{
+		this->Wait();
+
+		int length = 0;
+		glGetProgramiv(this->Id, GL_PROGRAM_BINARY_LENGTH, &length);
+
+		if (length <= 0)
+		{
+			return false;
+		}
+
+		data.resize(length);
+		glGetProgramBinary(this->Id, length, &length, &format, data.data());
+		data.resize(length);
+
+		return length > 0;
+	}
+
+	// Returns false and leaves no program behind when the driver rejects the binary,
+	// e.g. after a driver update.
+	bool LoadBinary(GLenum format, const void* data, int length)
+	{
+		int success;
+
+		this->Destroy();
+
+		this->Id = glCreateProgram();
+
+		if (this->bBinaryRetrievable)
+		{
+			glProgramParameteri(this->Id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+
+		glProgramBinary(this->Id, format, data, length);
+		glGetProgramiv(this->Id, GL_LINK_STATUS, &success);
+
+		if (!success)
+		{
+			this->Destroy();
+			return false;
+		}
+
+		this->Reflect();
+
+		return true;
+	}
+
+	// Looked up in the table built at link time, uniforms the program does not have are -1
+	// without asking the driver.
 	int GetUniformLocation(const std::string& name)
 	{
-		if (this->uniformLocations.find(name) == this->uniformLocations.end())
+		if (this->bUsingFallback)
+		{
+			return this->fallback->GetUniformLocation(name);
+		}
+
+		this->Wait();
+
+		int index = this->GetUniformIndex(name);
+
+		return index >= 0 ? this->uniforms[index].Location : -1;
+	}
+
+	int GetUniformIndex(const std::string& name)
+	{
+		int index = this->GetUniformIndex(GLHashName(name));
+
+		if (index < 0)
+		{
+			return -1;
+		}
+
+		// Array entries are also found under the plain array name.
+		const std::string& uniformName = this->uniforms[index].Name;
+		bool bMatch = uniformName == name || (uniformName.size() == name.size() + 3 && uniformName.compare(0, name.size(), name) == 0);
+
+		return bMatch ? index : -1;
+	}
+
+	int GetUniformIndex(uint32_t nameHash)
+	{
+		auto position = std::lower_bound(this->uniformHashes.begin(), this->uniformHashes.end(), std::make_pair(nameHash, -1));
+
+		return position != this->uniformHashes.end() && position->first == nameHash ? position->second : -1;
+	}
+
+	// Slot lookups are resolved on first use per program, later calls are an array index.
+	template <typename T>
+	int Resolve(const GLUniformHandle<T>& handle)
+	{
+		int slot = handle.GetSlot();
+
+		if (slot >= (int)this->slotIndices.size())
+		{
+			this->slotIndices.resize(GLUniformSlots::GetCount(), UNRESOLVED_SLOT);
+		}
+
+		if (this->slotIndices[slot] == UNRESOLVED_SLOT)
+		{
+			this->Wait();
+
+			int index = this->GetUniformIndex(handle.GetNameHash());
+
+			if (index >= 0 && !GLUniformType<T>::Accepts(this->uniforms[index].Type))
+			{
+				std::cout << "GLShader: Uniform Type Mismatch " << this->uniforms[index].Name << std::endl;
+				index = -1;
+			}
+
+			this->slotIndices[slot] = index;
+		}
+
+		return this->slotIndices[slot];
+	}
+
+	template <typename T>
+	bool HasUniform(const GLUniformHandle<T>& handle)
+	{
+		return (this->bUsingFallback ? this->fallback->Resolve(handle) : this->Resolve(handle)) >= 0;
+	}
+
+	template <typename T>
+	void SetUniform(const GLUniformHandle<T>& handle, const T& value)
+	{
+		GLShader* target = this->GetActiveProgram();
+
+		int index = target->Resolve(handle);
+
+		if (index >= 0)
 		{
-			int location = glGetUniformLocation(this->GetId(), name.c_str());
+			target->SetUniform(target->uniforms[index].Location, value);
+		}
+	}
 
-			if (location >= 0)
+	template <typename T>
+	GLUniform<T> GetUniform(const std::string& name)
+	{
+		this->Wait();
+
+		GLUniform<T> uniform;
+		uniform.Index = this->GetUniformIndex(name);
+
+		if (uniform.IsValid() && !GLUniformType<T>::Accepts(this->uniforms[uniform.Index].Type))
+		{
+			std::cout << "GLShader: Uniform Type Mismatch " << name << std::endl;
+			uniform.Index = -1;
+		}
+
+		return uniform;
+	}
+
+	const std::vector<GLUniformInfo>& GetUniforms()
+	{
+		this->Wait();
+
+		return this->uniforms;
+	}
+
+	const std::vector<GLUniformBlockInfo>& GetUniformBlocks()
+	{
+		this->Wait();
+
+		return this->uniformBlocks;
+	}
+
+	unsigned int GetUniformBlockIndex(const std::string& name)
+	{
+		for (const auto& block : this->GetUniformBlocks())
+		{
+			if (block.Name == name)
 			{
-				this->uniformLocations[name] = location;
+				return block.Index;
 			}
-			else
+		}
+
+		return GL_INVALID_INDEX;
+	}
+
+	void SetUniformBlockBinding(const std::string& name, int binding)
+	{
+		this->Wait();
+
+		for (auto& block : this->uniformBlocks)
+		{
+			if (block.Name == name)
 			{
-				return -1;
+				glUniformBlockBinding(this->Id, block.Index, binding);
+				block.Binding = binding;
 			}
 		}
+	}
+
+	template <typename T>
+	void SetUniform(const GLUniform<T>& uniform, const T& value)
+	{
+		if (!uniform.IsValid())
+		{
+			return;
+		}
+
+		if (this->bUsingFallback)
+		{
+			this->SetUniform(this->fallback->GetUniformLocation(this->uniforms[uniform.Index].Name), value);
+			return;
+		}
 
-		return this->uniformLocations[name];
+		this->SetUniform(this->uniforms[uniform.Index].Location, value);
 	}
 
 	template <typename T>
@@ -208,177 +784,396 @@ public:
 
 	void SetUniform(int uniformLocation, int value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform1i(uniformLocation, value);
 	}
 
 	void SetUniform(int uniformLocation, const glm::tvec2<int>& value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform2i(uniformLocation, value.x, value.y);
 	}
 
 	void SetUniform(int uniformLocation, const glm::tvec3<int>& value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform3i(uniformLocation, value.x, value.y, value.z);
 	}
 
 	void SetUniform(int uniformLocation, const glm::tvec4<int>& value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform4i(uniformLocation, value.x, value.y, value.z, value.w);
 	}
 
 	void SetUniform(int uniformLocation, unsigned int value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform1ui(uniformLocation, value);
 	}
 
 	void SetUniform(int uniformLocation, const glm::tvec2<unsigned int>& value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform2ui(uniformLocation, value.x, value.y);
 	}
 
 	void SetUniform(int uniformLocation, const glm::tvec3<unsigned int>& value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform3ui(uniformLocation, value.x, value.y, value.z);
 	}
 
 	void SetUniform(int uniformLocation, const glm::tvec4<unsigned int>& value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform4ui(uniformLocation, value.x, value.y, value.z, value.w);
 	}
 
 	void SetUniform(int uniformLocation, GLfloat value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform1f(uniformLocation, value);
 	}
 
 	void SetUniform(int uniformLocation, const glm::tvec2<GLfloat>& value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform2f(uniformLocation, value.x, value.y);
 	}
 
 	void SetUniform(int uniformLocation, const glm::tvec3<GLfloat>& value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform3f(uniformLocation, value.x, value.y, value.z);
 	}
 
 	void SetUniform(int uniformLocation, const glm::tvec4<GLfloat>& value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform4f(uniformLocation, value.x, value.y, value.z, value.w);
 	}
 
 	void SetUniform(int uniformLocation, GLdouble value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform1d(uniformLocation, value);
 	}
 
 	void SetUniform(int uniformLocation, const glm::tvec2<GLdouble>& value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform2d(uniformLocation, value.x, value.y);
 	}
 
 	void SetUniform(int uniformLocation, const glm::tvec3<GLdouble>& value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform3d(uniformLocation, value.x, value.y, value.z);
 	}
 
 	void SetUniform(int uniformLocation, const glm::tvec4<GLdouble>& value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniform4d(uniformLocation, value.x, value.y, value.z, value.w);
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat2x2<GLfloat> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix2fv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat2x3<GLfloat> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix2x3fv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat2x4<GLfloat> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix2x4fv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat3x2<GLfloat> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix3x2fv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat3x3<GLfloat> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix3fv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat3x4<GLfloat> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix3x4fv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat4x2<GLfloat> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix4x2fv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat4x3<GLfloat> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix4x3fv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat4x4<GLfloat> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix4fv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat2x2<GLdouble> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix2dv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat2x3<GLdouble> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix2x3dv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat2x4<GLdouble> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix2x4dv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat3x2<GLdouble> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix3x2dv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat3x3<GLdouble> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix3dv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat3x4<GLdouble> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix3x4dv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat4x2<GLdouble> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix4x2dv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat4x3<GLdouble> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix4x3dv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 	void SetUniform(int uniformLocation, glm::tmat4x4<GLdouble> value)
 	{
+		if (this->IsUnchanged(uniformLocation, value))
+		{
+			return;
+		}
+
 		glUniformMatrix4dv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
+	static void SetBlockBinding(const std::string& blockName, GLUniformBlockBinding binding)
+	{
+		blockBindings[blockName] = binding;
+	}
+
+	static void SetBlockBinding(const std::string& blockName, GLStorageBlockBinding binding)
+	{
+		storageBlockBindings[blockName] = binding;
+	}
+
+	// Forgets the last uploaded values, e.g. after the program was changed with raw glUniform calls.
+	void InvalidateUniforms()
+	{
+		for (auto& shadow : this->shadows)
+		{
+			shadow.bValid = false;
+		}
+	}
+
+	static bool IsShadowingEnabled()
+	{
+		return bShadowing;
+	}
+
+	static void SetShadowingEnabled(bool enabled)
+	{
+		bShadowing = enabled;
+	}
+
+	static GLUniformUploadStats GetUploadStats()
+	{
+		return uploadStats;
+	}
+
+	static void ResetUploadStats()
+	{
+		uploadStats = GLUniformUploadStats();
+	}
+
 	void Use()
 	{
-		glUseProgram(this->GetId());
+		this->bUsingFallback = this->bPending && this->fallback != nullptr && !this->IsReady();
+
+		if (this->bUsingFallback)
+		{
+			this->fallback->Use();
+			return;
+		}
+
+		this->Wait();
+
+		GLStateCache::UseProgram(this->GetId());
 	}
 
 protected:
@@ -388,6 +1183,12 @@ protected:
 		char infoLog[1024];
 
 		this->Id = glCreateProgram();
+
+		if (this->bBinaryRetrievable)
+		{
+			glProgramParameteri(this->Id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+
 		glAttachShader(this->Id, vertexShaderLoader.GetId());
 		glAttachShader(this->Id, fragmentShaderLoader.GetId());
 		glLinkProgram(this->Id);
@@ -403,10 +1204,364 @@ protected:
 
 		glDeleteShader(vertexShaderLoader.GetId());
 		glDeleteShader(fragmentShaderLoader.GetId());
+
+		this->Reflect();
 	}
 
 private:
+	static constexpr int UNRESOLVED_SLOT = -2;
+
+	struct UniformShadow
+	{
+		int Offset = 0;
+		int Size = 0;
+		bool bValid = false;
+	};
+
+	// Program whose uniforms are actually written, i.e. the fallback while this one is compiling.
+	GLShader* GetActiveProgram()
+	{
+		GLShader* program = this;
+
+		while (program->bUsingFallback)
+		{
+			program = program->fallback.get();
+		}
+
+		return program;
+	}
+
+	// Uniform values are program state, so the last value sent to a location stays valid across
+	// program switches. Values of a size the uniform does not have are always uploaded.
+	template <typename T>
+	bool IsUnchanged(int uniformLocation, const T& value)
+	{
+		if (uniformLocation < 0)
+		{
+			return true;
+		}
+
+		GLShader* program = this->GetActiveProgram();
+
+		int index = uniformLocation < (int)program->locationIndices.size() ? program->locationIndices[uniformLocation] : -1;
+
+		if (!bShadowing || index < 0 || program->shadows[index].Size != (int)sizeof(T))
+		{
+			uploadStats.Issued++;
+			return false;
+		}
+
+		UniformShadow& shadow = program->shadows[index];
+		unsigned char* shadowValue = program->shadowValues.data() + shadow.Offset;
+
+		if (shadow.bValid && std::memcmp(shadowValue, &value, sizeof(T)) == 0)
+		{
+			uploadStats.Skipped++;
+			return true;
+		}
+
+		std::memcpy(shadowValue, &value, sizeof(T));
+		shadow.bValid = true;
+
+		uploadStats.Issued++;
+		return false;
+	}
+
+	static int GetUniformTypeSize(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_FLOAT:
+		case GL_INT:
+		case GL_UNSIGNED_INT:
+		case GL_BOOL:
+			return 4;
+		case GL_FLOAT_VEC2:
+		case GL_INT_VEC2:
+		case GL_BOOL_VEC2:
+		case GL_UNSIGNED_INT_VEC2:
+		case GL_DOUBLE:
+			return 8;
+		case GL_FLOAT_VEC3:
+		case GL_INT_VEC3:
+		case GL_BOOL_VEC3:
+		case GL_UNSIGNED_INT_VEC3:
+			return 12;
+		case GL_FLOAT_VEC4:
+		case GL_INT_VEC4:
+		case GL_BOOL_VEC4:
+		case GL_UNSIGNED_INT_VEC4:
+		case GL_FLOAT_MAT2:
+		case GL_DOUBLE_VEC2:
+			return 16;
+		case GL_FLOAT_MAT2x3:
+		case GL_FLOAT_MAT3x2:
+		case GL_DOUBLE_VEC3:
+			return 24;
+		case GL_FLOAT_MAT2x4:
+		case GL_FLOAT_MAT4x2:
+		case GL_DOUBLE_VEC4:
+		case GL_DOUBLE_MAT2:
+			return 32;
+		case GL_FLOAT_MAT3:
+			return 36;
+		case GL_FLOAT_MAT3x4:
+		case GL_FLOAT_MAT4x3:
+		case GL_DOUBLE_MAT2x3:
+		case GL_DOUBLE_MAT3x2:
+			return 48;
+		case GL_FLOAT_MAT4:
+		case GL_DOUBLE_MAT2x4:
+		case GL_DOUBLE_MAT4x2:
+			return 64;
+		case GL_DOUBLE_MAT3:
+			return 72;
+		case GL_DOUBLE_MAT3x4:
+		case GL_DOUBLE_MAT4x3:
+			return 96;
+		case GL_DOUBLE_MAT4:
+			return 128;
+		default:
+			// Samplers and images are set as int.
+			return 4;
+		}
+	}
+
+	void FinishCompile()
+	{
+		int success;
+		char infoLog[1024];
+
+		glGetShaderiv(this->vertexId, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(this->vertexId, 1024, NULL, infoLog);
+			std::cout << "GLVertexShader: Vertex Shader Compile Error" << std::endl;
+			std::cout << infoLog << std::endl;
+		}
+
+		glGetShaderiv(this->fragmentId, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(this->fragmentId, 1024, NULL, infoLog);
+			std::cout << "GLFragmentShader: Fragment Shader Compile Error" << std::endl;
+			std::cout << infoLog << std::endl;
+		}
+
+		glGetProgramiv(this->Id, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glGetProgramInfoLog(this->Id, 1024, NULL, infoLog);
+			std::cout << "GLShader: Program Linking Error" << std::endl;
+			std::cout << infoLog << std::endl;
+		}
+
+		this->DeleteStages();
+
+		this->bPending = false;
+
+		this->Reflect();
+	}
+
+	// Builds the uniform table once after linking. Every element of a uniform array gets its
+	// own entry, the first one also under the plain array name.
+	void Reflect()
+	{
+		this->uniforms.clear();
+		this->uniformHashes.clear();
+		this->uniformBlocks.clear();
+		this->slotIndices.clear();
+		this->locationIndices.clear();
+		this->shadows.clear();
+		this->shadowValues.clear();
+
+		int success = GL_FALSE;
+		glGetProgramiv(this->Id, GL_LINK_STATUS, &success);
+
+		if (!success)
+		{
+			return;
+		}
+
+		int uniformCount = 0;
+		int maxNameLength = 0;
+
+		glGetProgramiv(this->Id, GL_ACTIVE_UNIFORMS, &uniformCount);
+		glGetProgramiv(this->Id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+		std::vector<char> nameBuffer(maxNameLength + 1);
+
+		for (int i = 0; i < uniformCount; ++i)
+		{
+			unsigned int uniformIndex = i;
+			int blockIndex = -1;
+
+			glGetActiveUniformsiv(this->Id, 1, &uniformIndex, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+
+			if (blockIndex >= 0)
+			{
+				continue;
+			}
+
+			int arraySize = 0;
+			GLenum type = 0;
+
+			glGetActiveUniform(this->Id, i, (int)nameBuffer.size(), NULL, &arraySize, &type, nameBuffer.data());
+
+			std::string name = nameBuffer.data();
+			std::string baseName = name;
+
+			if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+			{
+				baseName = name.substr(0, name.size() - 3);
+				this->uniformHashes.push_back(std::make_pair(GLHashName(baseName), (int)this->uniforms.size()));
+			}
+
+			for (int element = 0; element < arraySize; ++element)
+			{
+				GLUniformInfo uniform;
+				uniform.Name = element == 0 ? name : baseName + "[" + std::to_string(element) + "]";
+				uniform.Location = glGetUniformLocation(this->Id, uniform.Name.c_str());
+				uniform.Type = type;
+
+				this->uniformHashes.push_back(std::make_pair(GLHashName(uniform.Name), (int)this->uniforms.size()));
+				this->uniforms.push_back(uniform);
+			}
+		}
+
+		std::sort(this->uniformHashes.begin(), this->uniformHashes.end());
+
+		// One shadow value per uniform, reached from its location without a search.
+		int shadowSize = 0;
+
+		for (size_t i = 0; i < this->uniforms.size(); ++i)
+		{
+			const GLUniformInfo& uniform = this->uniforms[i];
+
+			UniformShadow shadow;
+			shadow.Offset = shadowSize;
+			shadow.Size = GetUniformTypeSize(uniform.Type);
+
+			shadowSize += shadow.Size;
+			this->shadows.push_back(shadow);
+
+			if (uniform.Location >= 0)
+			{
+				if (uniform.Location >= (int)this->locationIndices.size())
+				{
+					this->locationIndices.resize(uniform.Location + 1, -1);
+				}
+
+				this->locationIndices[uniform.Location] = (int)i;
+			}
+		}
+
+		this->shadowValues.assign(shadowSize, 0);
+
+		for (size_t i = 1; i < this->uniformHashes.size(); ++i)
+		{
+			if (this->uniformHashes[i].first == this->uniformHashes[i - 1].first)
+			{
+				std::cout << "GLShader: Uniform Name Hash Collision " << this->uniforms[this->uniformHashes[i].second].Name << std::endl;
+			}
+		}
+
+		int blockCount = 0;
+		glGetProgramiv(this->Id, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+		glGetProgramiv(this->Id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+
+		nameBuffer.resize(maxNameLength + 1);
+
+		for (int i = 0; i < blockCount; ++i)
+		{
+			GLUniformBlockInfo block;
+
+			glGetActiveUniformBlockName(this->Id, i, (int)nameBuffer.size(), NULL, nameBuffer.data());
+			glGetActiveUniformBlockiv(this->Id, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.DataSize);
+			glGetActiveUniformBlockiv(this->Id, i, GL_UNIFORM_BLOCK_BINDING, &block.Binding);
+
+			block.Name = nameBuffer.data();
+			block.Index = i;
+
+			auto binding = blockBindings.find(block.Name);
+
+			if (binding != blockBindings.end())
+			{
+				block.Binding = (int)binding->second;
+				glUniformBlockBinding(this->Id, block.Index, block.Binding);
+			}
+
+			this->uniformBlocks.push_back(block);
+		}
+
+		// Storage blocks are only looked up by name, programs without them skip the binding.
+		if (GLEW_ARB_shader_storage_buffer_object)
+		{
+			for (const auto& binding : storageBlockBindings)
+			{
+				GLuint index = glGetProgramResourceIndex(this->Id, GL_SHADER_STORAGE_BLOCK, binding.first.c_str());
+
+				if (index != GL_INVALID_INDEX)
+				{
+					glShaderStorageBlockBinding(this->Id, index, (GLuint)binding.second);
+				}
+			}
+		}
+	}
+
+	void DeleteStages()
+	{
+		if (this->vertexId != 0)
+		{
+			glDeleteShader(this->vertexId);
+			this->vertexId = 0;
+		}
+
+		if (this->fragmentId != 0)
+		{
+			glDeleteShader(this->fragmentId);
+			this->fragmentId = 0;
+		}
+	}
+
 	unsigned int Id = -1;
 
-	std::unordered_map<std::string, int> uniformLocations;
+	unsigned int vertexId = 0;
+	unsigned int fragmentId = 0;
+
+	bool bPending = false;
+	bool bUsingFallback = false;
+
+	GLSharedPtr<GLShader> fallback = nullptr;
+
+	bool bBinaryRetrievable = false;
+
+	std::vector<GLUniformInfo> uniforms;
+	std::vector<std::pair<uint32_t, int>> uniformHashes;
+	std::vector<int> slotIndices;
+	std::vector<GLUniformBlockInfo> uniformBlocks;
+
+	std::vector<int> locationIndices;
+	std::vector<UniformShadow> shadows;
+	std::vector<unsigned char> shadowValues;
+
+	static bool bShadowing;
+	static GLUniformUploadStats uploadStats;
+
+	static std::unordered_map<std::string, GLUniformBlockBinding> blockBindings;
+	static std::unordered_map<std::string, GLStorageBlockBinding> storageBlockBindings;
+};
+
+bool GLShader::bShadowing = true;
+GLUniformUploadStats GLShader::uploadStats;
+
+std::unordered_map<std::string, GLUniformBlockBinding> GLShader::blockBindings =
+{
+	{ "Camera", GLUniformBlockBinding::Camera },
+	{ "Lights", GLUniformBlockBinding::Lights }
+};
+
+std::unordered_map<std::string, GLStorageBlockBinding> GLShader::storageBlockBindings =
+{
+	{ "Draws", GLStorageBlockBinding::Draws }
 };
\ No newline at end of file
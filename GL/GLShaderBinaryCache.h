@@ -0,0 +1,226 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+
+#include <gl/glew.h>
+
+#include "GLMemoryHelpers.h"
+#include "GLShader.h"
+
+struct GLShaderBinaryCacheStats
+{
+	size_t Hits = 0;
+	size_t Misses = 0;
+	size_t Rejected = 0;
+	size_t Stored = 0;
+};
+
+// Linked program binaries stored on disk, one file per program. The file name is a hash of
+// both stage sources (defines already injected) and the driver vendor, renderer and version,
+// so a driver update simply misses. Binaries the driver still rejects are deleted and the
+// caller compiles from source again.
+class GLShaderBinaryCache
+{
+public:
+	// Some drivers expose the entry points but no binary formats.
+	static bool IsSupported()
+	{
+		if (formatCount < 0)
+		{
+			formatCount = 0;
+
+			if (GLEW_ARB_get_program_binary || GLEW_VERSION_4_1)
+			{
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+			}
+		}
+
+		return formatCount > 0;
+	}
+
+	static bool IsEnabled()
+	{
+		return bEnabled;
+	}
+
+	static void SetEnabled(bool enabled)
+	{
+		bEnabled = enabled;
+	}
+
+	static const std::string& GetDirectory()
+	{
+		return directory;
+	}
+
+	static void SetDirectory(const std::string& path)
+	{
+		directory = path;
+	}
+
+	static bool Load(const GLSharedPtr<GLShader>& shader, const std::string& vertexSource, const std::string& fragmentSource)
+	{
+		if (!bEnabled || !IsSupported())
+		{
+			return false;
+		}
+
+		shader->SetBinaryRetrievable(true);
+
+		uint64_t key = GetKey(vertexSource, fragmentSource);
+		std::string path = GetPath(key);
+
+		std::ifstream file(path, std::ios::binary);
+
+		if (!file.is_open())
+		{
+			stats.Misses++;
+			return false;
+		}
+
+		uint32_t magic = 0;
+		uint64_t storedKey = 0;
+		uint32_t format = 0;
+
+		file.read((char*)&magic, sizeof(magic));
+		file.read((char*)&storedKey, sizeof(storedKey));
+		file.read((char*)&format, sizeof(format));
+
+		std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		file.close();
+
+		if (magic != MAGIC || storedKey != key || data.empty() || !shader->LoadBinary(format, data.data(), (int)data.size()))
+		{
+			std::cout << "GLShaderBinaryCache: Stale Binary " << path << ", Recompiling." << std::endl;
+
+			std::error_code error;
+			std::filesystem::remove(path, error);
+
+			stats.Rejected++;
+			return false;
+		}
+
+		stats.Hits++;
+
+		return true;
+	}
+
+	static void Store(const GLSharedPtr<GLShader>& shader, const std::string& vertexSource, const std::string& fragmentSource)
+	{
+		if (!bEnabled || !IsSupported())
+		{
+			return;
+		}
+
+		GLenum format = 0;
+		std::vector<char> data;
+
+		if (!shader->GetBinary(format, data))
+		{
+			return;
+		}
+
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+
+		uint64_t key = GetKey(vertexSource, fragmentSource);
+		std::ofstream file(GetPath(key), std::ios::binary | std::ios::trunc);
+
+		if (!file.is_open())
+		{
+			std::cout << "GLShaderBinaryCache: Cannot Write To " << directory << std::endl;
+			return;
+		}
+
+		uint32_t magic = MAGIC;
+		uint32_t storedFormat = format;
+
+		file.write((const char*)&magic, sizeof(magic));
+		file.write((const char*)&key, sizeof(key));
+		file.write((const char*)&storedFormat, sizeof(storedFormat));
+		file.write(data.data(), data.size());
+
+		stats.Stored++;
+	}
+
+	// Removes every cached binary, e.g. to measure a cold start.
+	static void Clear()
+	{
+		std::error_code error;
+		std::filesystem::remove_all(directory, error);
+	}
+
+	static GLShaderBinaryCacheStats GetStats()
+	{
+		return stats;
+	}
+
+	static uint64_t Hash(const std::string& text, uint64_t hash = 14695981039346656037ull)
+	{
+		for (unsigned char character : text)
+		{
+			hash ^= character;
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+private:
+	static const uint32_t MAGIC = 0x42504C47;
+
+	static uint64_t GetKey(const std::string& vertexSource, const std::string& fragmentSource)
+	{
+		uint64_t hash = Hash(GetDriverString());
+		hash = Hash(std::string(1, '\0') + vertexSource, hash);
+		hash = Hash(std::string(1, '\0') + fragmentSource, hash);
+
+		return hash;
+	}
+
+	static const std::string& GetDriverString()
+	{
+		if (driverString.empty())
+		{
+			const char* vendor = (const char*)glGetString(GL_VENDOR);
+			const char* renderer = (const char*)glGetString(GL_RENDERER);
+			const char* version = (const char*)glGetString(GL_VERSION);
+
+			driverString = std::string(vendor ? vendor : "") + '\n' + (renderer ? renderer : "") + '\n' + (version ? version : "");
+		}
+
+		return driverString;
+	}
+
+	static std::string GetPath(uint64_t key)
+	{
+		std::stringstream name;
+		name << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+
+		return (std::filesystem::path(directory) / name.str()).string();
+	}
+
+	static std::string directory;
+	static std::string driverString;
+
+	static int formatCount;
+	static bool bEnabled;
+
+	static GLShaderBinaryCacheStats stats;
+};
+
+std::string GLShaderBinaryCache::directory = "shadercache";
+std::string GLShaderBinaryCache::driverString;
+
+int GLShaderBinaryCache::formatCount = -1;
+bool GLShaderBinaryCache::bEnabled = true;
+
+GLShaderBinaryCacheStats GLShaderBinaryCache::stats;
\ No newline at end of file
@@ -0,0 +1,362 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <chrono>
+#include <sstream>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "GLMemoryHelpers.h"
+#include "GLShader.h"
+#include "GLShaderBinaryCache.h"
+
+using GLShaderDefines = std::map<std::string, std::string>;
+
+struct GLShaderRegistryStats
+{
+	size_t Requests = 0;
+	size_t Hits = 0;
+
+	size_t LinkedPrograms = 0;
+	size_t CachedPrograms = 0;
+	size_t AsyncPrograms = 0;
+	size_t PendingPrograms = 0;
+	double CompileMilliseconds = 0.0;
+};
+
+// Programs are shared by every user of the same stage sources and defines. The registry
+// holds one reference, so a program is released once Collect finds nobody else using it.
+class GLShaderRegistry
+{
+public:
+	static GLSharedPtr<GLShader> Load(const std::string& vertexFilename, const std::string& fragmentFilename,
+		const GLShaderDefines& defines = GLShaderDefines(), const GLSharedPtr<GLShader>& fallback = nullptr)
+	{
+		std::string fileKey = GetKey(vertexFilename, fragmentFilename, defines);
+
+		auto position = fileKeys.find(fileKey);
+
+		if (position != fileKeys.end())
+		{
+			auto program = programs.find(position->second);
+
+			if (program != programs.end())
+			{
+				stats.Requests++;
+				stats.Hits++;
+
+				return program->second;
+			}
+		}
+
+		const std::string& vertexSource = GetFileSource(vertexFilename);
+		const std::string& fragmentSource = GetFileSource(fragmentFilename);
+
+		fileKeys[fileKey] = GetKey(vertexSource, fragmentSource, defines);
+
+		return Get(vertexSource, fragmentSource, defines, fallback);
+	}
+
+	// With async compile enabled, new programs are only submitted here. The fallback is bound
+	// in their place until they are ready; without one, the first use waits for the driver.
+	static GLSharedPtr<GLShader> Get(const std::string& vertexSource, const std::string& fragmentSource,
+		const GLShaderDefines& defines = GLShaderDefines(), const GLSharedPtr<GLShader>& fallback = nullptr)
+	{
+		stats.Requests++;
+
+		std::string key = GetKey(vertexSource, fragmentSource, defines);
+
+		auto position = programs.find(key);
+
+		if (position != programs.end())
+		{
+			stats.Hits++;
+
+			return position->second;
+		}
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		std::string vertexVariant = InjectDefines(vertexSource, defines);
+		std::string fragmentVariant = InjectDefines(fragmentSource, defines);
+
+		auto shader = GLCreate<GLShader>();
+
+		if (GLShaderBinaryCache::Load(shader, vertexVariant, fragmentVariant))
+		{
+			stats.CachedPrograms++;
+		}
+		else if (bAsync)
+		{
+			if (pending.empty() && GLShader::IsParallelCompileSupported())
+			{
+				// Let the driver pick as many compiler threads as it likes.
+				GLEW_KHR_parallel_shader_compile ? glMaxShaderCompilerThreadsKHR(0xFFFFFFFF) : glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+			}
+
+			shader->CompileAsync(vertexVariant, fragmentVariant);
+			shader->SetFallback(fallback);
+
+			pending.push_back({ shader, vertexVariant, fragmentVariant });
+
+			stats.AsyncPrograms++;
+		}
+		else
+		{
+			shader->Compile(vertexVariant, fragmentVariant);
+			GLShaderBinaryCache::Store(shader, vertexVariant, fragmentVariant);
+		}
+
+		auto finishedTime = std::chrono::high_resolution_clock::now();
+
+		stats.LinkedPrograms++;
+		stats.CompileMilliseconds += std::chrono::duration<double, std::milli>(finishedTime - startTime).count();
+
+		programs[key] = shader;
+
+		return shader;
+	}
+
+	// Finishes programs the driver is done with and stores their binaries. Called once per frame.
+	// Returns the number of programs still compiling.
+	static size_t PollPending()
+	{
+		for (auto position = pending.begin(); position != pending.end();)
+		{
+			if (position->Shader->IsReady())
+			{
+				GLShaderBinaryCache::Store(position->Shader, position->VertexSource, position->FragmentSource);
+				position = pending.erase(position);
+			}
+			else
+			{
+				++position;
+			}
+		}
+
+		return pending.size();
+	}
+
+	static void WaitAll()
+	{
+		for (auto& program : pending)
+		{
+			program.Shader->Wait();
+			GLShaderBinaryCache::Store(program.Shader, program.VertexSource, program.FragmentSource);
+		}
+
+		pending.clear();
+	}
+
+	static bool IsAsync()
+	{
+		return bAsync;
+	}
+
+	static void SetAsync(bool async)
+	{
+		bAsync = async;
+	}
+
+	// Number of references held outside the registry.
+	static long GetReferenceCount(const GLSharedPtr<GLShader>& shader)
+	{
+		for (auto& entry : programs)
+		{
+			if (entry.second == shader)
+			{
+				return shader.use_count() - 1;
+			}
+		}
+
+		return shader.use_count();
+	}
+
+	// Drops the caller's reference and destroys the program if nobody else uses it.
+	static void Release(GLSharedPtr<GLShader>& shader)
+	{
+		shader = nullptr;
+
+		Collect();
+	}
+
+	// Destroys every program only referenced by the registry. Returns the number destroyed.
+	static size_t Collect()
+	{
+		size_t destroyed = 0;
+
+		for (auto position = programs.begin(); position != programs.end();)
+		{
+			if (position->second.use_count() == 1)
+			{
+				position->second->Destroy();
+				position = programs.erase(position);
+
+				destroyed++;
+			}
+			else
+			{
+				++position;
+			}
+		}
+
+		return destroyed;
+	}
+
+	// Destroys every program regardless of remaining references. Must run while the GL context is alive.
+	static void DestroyAll()
+	{
+		for (auto& entry : programs)
+		{
+			entry.second->Destroy();
+		}
+
+		programs.clear();
+		pending.clear();
+	}
+
+	static size_t GetProgramCount()
+	{
+		return programs.size();
+	}
+
+	static GLShaderRegistryStats GetStats()
+	{
+		GLShaderRegistryStats current = stats;
+		current.PendingPrograms = pending.size();
+
+		return current;
+	}
+
+	static void Report(std::ostream& stream = std::cout)
+	{
+		stream << "GLShaderRegistry: " << stats.LinkedPrograms << " programs linked ("
+			<< stats.CachedPrograms << " from binary cache, "
+			<< stats.AsyncPrograms << " async, " << pending.size() << " still compiling) in "
+			<< stats.CompileMilliseconds << " ms, "
+			<< stats.Hits << " of " << stats.Requests << " requests shared." << std::endl;
+	}
+
+	// Inserts a #define line per entry right after the #version directive.
+	static std::string InjectDefines(const std::string& source, const GLShaderDefines& defines)
+	{
+		if (defines.empty())
+		{
+			return source;
+		}
+
+		std::string defineLines;
+
+		for (const auto& define : defines)
+		{
+			defineLines += "#define " + define.first + " " + define.second + "\n";
+		}
+
+		size_t insertPosition = 0;
+
+		if (source.compare(0, 8, "#version") == 0)
+		{
+			insertPosition = source.find('\n');
+			insertPosition = insertPosition == std::string::npos ? source.size() : insertPosition + 1;
+		}
+
+		std::string injected = source;
+		injected.insert(insertPosition, defineLines);
+
+		return injected;
+	}
+
+private:
+	struct PendingProgram
+	{
+		GLSharedPtr<GLShader> Shader;
+		std::string VertexSource;
+		std::string FragmentSource;
+	};
+
+	static std::string GetKey(const std::string& vertex, const std::string& fragment, const GLShaderDefines& defines)
+	{
+		std::string key = vertex + '\0' + fragment;
+
+		for (const auto& define : defines)
+		{
+			key += '\0' + define.first + '=' + define.second;
+		}
+
+		return key;
+	}
+
+	static const std::string& GetFileSource(const std::string& filename)
+	{
+		auto position = fileSources.find(filename);
+
+		if (position == fileSources.end())
+		{
+			std::unordered_set<std::string> included;
+			position = fileSources.emplace(filename, ResolveIncludes(filename, included)).first;
+		}
+
+		return position->second;
+	}
+
+	// Replaces #include "file" lines with the file contents, relative to the including file.
+	// Every file is included at most once.
+	static std::string ResolveIncludes(const std::string& filename, std::unordered_set<std::string>& included)
+	{
+		if (!included.insert(filename).second)
+		{
+			return "";
+		}
+
+		std::string directory = filename.substr(0, filename.find_last_of("/\\") + 1);
+
+		std::istringstream lines(GLShaderLoader(filename).GetSource());
+		std::string line;
+		std::string source;
+
+		while (std::getline(lines, line))
+		{
+			size_t start = line.find_first_not_of(" \t");
+
+			if (start != std::string::npos && line.compare(start, 8, "#include") == 0)
+			{
+				size_t open = line.find('"', start);
+				size_t close = line.find('"', open + 1);
+
+				if (open == std::string::npos || close == std::string::npos)
+				{
+					std::cout << "GLShaderRegistry: Malformed Include In " << filename << std::endl;
+					continue;
+				}
+
+				source += ResolveIncludes(directory + line.substr(open + 1, close - open - 1), included) + "\n";
+				continue;
+			}
+
+			source += line + "\n";
+		}
+
+		return source;
+	}
+
+	static std::unordered_map<std::string, GLSharedPtr<GLShader>> programs;
+	static std::unordered_map<std::string, std::string> fileKeys;
+	static std::unordered_map<std::string, std::string> fileSources;
+
+	static std::vector<PendingProgram> pending;
+	static bool bAsync;
+
+	static GLShaderRegistryStats stats;
+};
+
+std::unordered_map<std::string, GLSharedPtr<GLShader>> GLShaderRegistry::programs;
+std::unordered_map<std::string, std::string> GLShaderRegistry::fileKeys;
+std::unordered_map<std::string, std::string> GLShaderRegistry::fileSources;
+
+std::vector<GLShaderRegistry::PendingProgram> GLShaderRegistry::pending;
+bool GLShaderRegistry::bAsync = true;
+
+GLShaderRegistryStats GLShaderRegistry::stats;
\ No newline at end of file
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <gl/glew.h>
+
+#include "GLTextureBinder.h"
+
+struct GLStateCacheStats
+{
+	// Calls passed on to GL, and requests for state that was already set.
+	size_t Changes = 0;
+	size_t Skipped = 0;
+};
+
+// Shadow copy of the blend, cull and depth state, the color mask, bound program, vertex array,
+// buffers, draw framebuffer and viewport. Every engine change of this state goes through the
+// cache, so requests for the current state are skipped and the state is never queried back from
+// GL. Texture units are tracked by GLTextureBinder. The cache starts from the defaults of a new
+// context and has to be invalidated after state was changed without going through it.
+class GLStateCache
+{
+public:
+	// GL_BLEND, GL_CULL_FACE and GL_DEPTH_TEST are tracked, other capabilities are passed on.
+	static void SetEnabled(GLenum capability, bool bEnabled)
+	{
+		int index = GetCapabilityIndex(capability);
+		int value = bEnabled ? 1 : 0;
+
+		if (index >= 0 && capabilities[index] == value)
+		{
+			stats.Skipped++;
+			return;
+		}
+
+		if (bEnabled)
+		{
+			glEnable(capability);
+		}
+		else
+		{
+			glDisable(capability);
+		}
+
+		if (index >= 0)
+		{
+			capabilities[index] = value;
+		}
+
+		stats.Changes++;
+	}
+
+	// Only queries GL for untracked capabilities or after Invalidate.
+	static bool IsEnabled(GLenum capability)
+	{
+		int index = GetCapabilityIndex(capability);
+
+		if (index < 0)
+		{
+			return glIsEnabled(capability) == GL_TRUE;
+		}
+
+		if (capabilities[index] < 0)
+		{
+			capabilities[index] = glIsEnabled(capability) == GL_TRUE ? 1 : 0;
+		}
+
+		return capabilities[index] == 1;
+	}
+
+	static void SetBlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+	{
+		if (blendSourceFactor == sourceFactor && blendDestinationFactor == destinationFactor)
+		{
+			stats.Skipped++;
+			return;
+		}
+
+		glBlendFunc(sourceFactor, destinationFactor);
+
+		blendSourceFactor = sourceFactor;
+		blendDestinationFactor = destinationFactor;
+
+		stats.Changes++;
+	}
+
+	static void SetCullFace(GLenum mode)
+	{
+		if (cullFace == mode)
+		{
+			stats.Skipped++;
+			return;
+		}
+
+		glCullFace(mode);
+		cullFace = mode;
+
+		stats.Changes++;
+	}
+
+	static void SetDepthFunc(GLenum func)
+	{
+		if (depthFunc == func)
+		{
+			stats.Skipped++;
+			return;
+		}
+
+		glDepthFunc(func);
+		depthFunc = func;
+
+		stats.Changes++;
+	}
+
+	static void SetDepthMask(bool bWrite)
+	{
+		int value = bWrite ? 1 : 0;
+
+		if (depthMask == value)
+		{
+			stats.Skipped++;
+			return;
+		}
+
+		glDepthMask(bWrite ? GL_TRUE : GL_FALSE);
+		depthMask = value;
+
+		stats.Changes++;
+	}
+
+	static bool GetDepthMask()
+	{
+		if (depthMask < 0)
+		{
+			GLboolean value = GL_TRUE;
+			glGetBooleanv(GL_DEPTH_WRITEMASK, &value);
+
+			depthMask = value == GL_TRUE ? 1 : 0;
+		}
+
+		return depthMask == 1;
+	}
+
+	// All four channels at once.
+	static void SetColorMask(bool bWrite)
+	{
+		int value = bWrite ? 1 : 0;
+
+		if (colorMask == value)
+		{
+			stats.Skipped++;
+			return;
+		}
+
+		GLboolean mask = bWrite ? GL_TRUE : GL_FALSE;
+		glColorMask(mask, mask, mask, mask);
+		colorMask = value;
+
+		stats.Changes++;
+	}
+
+	static void UseProgram(GLuint id)
+	{
+		if (program == id)
+		{
+			stats.Skipped++;
+			return;
+		}
+
+		glUseProgram(id);
+		program = id;
+
+		stats.Changes++;
+	}
+
+	static void BindVertexArray(GLuint id)
+	{
+		if (vertexArray == id)
+		{
+			stats.Skipped++;
+			return;
+		}
+
+		glBindVertexArray(id);
+		vertexArray = id;
+
+		stats.Changes++;
+	}
+
+	// Binding points that are not part of the vertex array state are tracked, others are passed on.
+	static void BindBuffer(GLenum target, GLuint id)
+	{
+		int index = GetBufferTargetIndex(target);
+
+		if (index >= 0 && buffers[index] == id)
+		{
+			stats.Skipped++;
+			return;
+		}
+
+		glBindBuffer(target, id);
+
+		if (index >= 0)
+		{
+			buffers[index] = id;
+		}
+
+		stats.Changes++;
+	}
+
+	// Indexed bindings are not tracked, but GL binds the buffer to the generic binding point as well.
+	static void BindBufferBase(GLenum target, GLuint bindingIndex, GLuint id)
+	{
+		int index = GetBufferTargetIndex(target);
+
+		glBindBufferBase(target, bindingIndex, id);
+
+		if (index >= 0)
+		{
+			buffers[index] = id;
+		}
+
+		stats.Changes++;
+	}
+
+	static void BindDrawFramebuffer(GLuint id)
+	{
+		if (drawFramebuffer == id)
+		{
+			stats.Skipped++;
+			return;
+		}
+
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, id);
+		drawFramebuffer = id;
+
+		stats.Changes++;
+	}
+
+	static GLuint GetDrawFramebuffer()
+	{
+		if (drawFramebuffer == INVALID_ID)
+		{
+			GLint id = 0;
+			glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &id);
+
+			drawFramebuffer = (GLuint)id;
+		}
+
+		return drawFramebuffer;
+	}
+
+	static void SetViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		if (viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height)
+		{
+			stats.Skipped++;
+			return;
+		}
+
+		glViewport(x, y, width, height);
+
+		viewport[0] = x;
+		viewport[1] = y;
+		viewport[2] = width;
+		viewport[3] = height;
+
+		stats.Changes++;
+	}
+
+	// Deleted objects are unbound by GL and their names may be handed out again.
+	static void ForgetProgram(GLuint id)
+	{
+		if (program == id)
+		{
+			program = INVALID_ID;
+		}
+	}
+
+	static void ForgetVertexArray(GLuint id)
+	{
+		if (vertexArray == id)
+		{
+			vertexArray = INVALID_ID;
+		}
+	}
+
+	static void ForgetBuffer(GLuint id)
+	{
+		for (int index = 0; index < BUFFER_TARGET_COUNT; ++index)
+		{
+			if (buffers[index] == id)
+			{
+				buffers[index] = INVALID_ID;
+			}
+		}
+	}
+
+	static void ForgetFramebuffer(GLuint id)
+	{
+		if (drawFramebuffer == id)
+		{
+			drawFramebuffer = INVALID_ID;
+		}
+	}
+
+	// Must be called after state was changed without going through the cache, e.g. by other
+	// libraries drawing into the same context. The texture units are invalidated as well.
+	static void Invalidate()
+	{
+		for (int index = 0; index < CAPABILITY_COUNT; ++index)
+		{
+			capabilities[index] = -1;
+		}
+
+		blendSourceFactor = INVALID_ENUM;
+		blendDestinationFactor = INVALID_ENUM;
+		cullFace = INVALID_ENUM;
+		depthFunc = INVALID_ENUM;
+		depthMask = -1;
+		colorMask = -1;
+
+		program = INVALID_ID;
+		vertexArray = INVALID_ID;
+
+		for (int index = 0; index < BUFFER_TARGET_COUNT; ++index)
+		{
+			buffers[index] = INVALID_ID;
+		}
+
+		drawFramebuffer = INVALID_ID;
+
+		for (int i = 0; i < 4; ++i)
+		{
+			viewport[i] = -1;
+		}
+
+		GLTextureBinder::Invalidate();
+	}
+
+	static GLStateCacheStats GetStats()
+	{
+		return stats;
+	}
+
+	static void ResetStats()
+	{
+		stats = GLStateCacheStats();
+	}
+
+private:
+	static const int CAPABILITY_COUNT = 3;
+	static const int BUFFER_TARGET_COUNT = 7;
+
+	static const GLuint INVALID_ID = 0xFFFFFFFF;
+	static const GLenum INVALID_ENUM = 0xFFFFFFFF;
+
+	static int GetCapabilityIndex(GLenum capability)
+	{
+		switch (capability)
+		{
+		case GL_BLEND:
+			return 0;
+		case GL_CULL_FACE:
+			return 1;
+		case GL_DEPTH_TEST:
+			return 2;
+		default:
+			return -1;
+		}
+	}
+
+	static int GetBufferTargetIndex(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_ARRAY_BUFFER:
+			return 0;
+		case GL_UNIFORM_BUFFER:
+			return 1;
+		case GL_TEXTURE_BUFFER:
+			return 2;
+		case GL_DRAW_INDIRECT_BUFFER:
+			return 3;
+		case GL_SHADER_STORAGE_BUFFER:
+			return 4;
+		case GL_COPY_READ_BUFFER:
+			return 5;
+		case GL_COPY_WRITE_BUFFER:
+			return 6;
+		default:
+			return -1;
+		}
+	}
+
+	// Enabled, disabled or, below 0, unknown.
+	static int capabilities[CAPABILITY_COUNT];
+
+	static GLenum blendSourceFactor;
+	static GLenum blendDestinationFactor;
+	static GLenum cullFace;
+	static GLenum depthFunc;
+	static int depthMask;
+	static int colorMask;
+
+	static GLuint program;
+	static GLuint vertexArray;
+	static GLuint buffers[BUFFER_TARGET_COUNT];
+	static GLuint drawFramebuffer;
+
+	// Unknown until first set, the default is the size of the window.
+	static GLint viewport[4];
+
+	static GLStateCacheStats stats;
+};
+
+int GLStateCache::capabilities[GLStateCache::CAPABILITY_COUNT] = { 0, 0, 0 };
+
+GLenum GLStateCache::blendSourceFactor = GL_ONE;
+GLenum GLStateCache::blendDestinationFactor = GL_ZERO;
+GLenum GLStateCache::cullFace = GL_BACK;
+GLenum GLStateCache::depthFunc = GL_LESS;
+int GLStateCache::depthMask = 1;
+int GLStateCache::colorMask = 1;
+
+GLuint GLStateCache::program = 0;
+GLuint GLStateCache::vertexArray = 0;
+GLuint GLStateCache::buffers[GLStateCache::BUFFER_TARGET_COUNT] = { };
+GLuint GLStateCache::drawFramebuffer = 0;
+
+GLint GLStateCache::viewport[4] = { -1, -1, -1, -1 };
+
+GLStateCacheStats GLStateCache::stats;
\ No newline at end of file
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <gl/glew.h>
+#include <gl/glm/glm.hpp>
+
+#include "GLMemoryHelpers.h"
+#include "GLMesh.h"
+#include "GLMaterial.h"
+#include "GLMeshRenderer.h"
+#include "GLRenderQueue.h"
+#include "GLGameObject.h"
+
+struct GLStaticBatchStats
+{
+	size_t Rebuilds = 0;
+
+	size_t Batches = 0;
+	size_t Objects = 0;
+	size_t Vertices = 0;
+};
+
+// Merges the meshes of static objects sharing a material into world space batches, one per
+// chunk of space so a batch stays small enough to be culled. Opaque triangle meshes with
+// built-in materials are batched, other static objects are drawn as usual. Meshes used by
+// several static objects are left to instancing, which draws them all at once already.
+class GLStaticBatcher
+{
+public:
+	// Chunks are cubes of this size in world units.
+	void SetChunkSize(float chunkSize)
+	{
+		this->chunkSize = chunkSize;
+		this->bBuilt = false;
+	}
+
+	float GetChunkSize()
+	{
+		return this->chunkSize;
+	}
+
+	// Rebuilds the batches if static content changed since the last call.
+	void Update(const GLSharedPtr<GLGameObject>& root)
+	{
+		if (this->bBuilt && this->version == GLGameObject::GetStaticVersion())
+		{
+			return;
+		}
+
+		this->Rebuild(root);
+
+		this->version = GLGameObject::GetStaticVersion();
+		this->bBuilt = true;
+	}
+
+	void Enqueue(const std::string& layer, GLRenderCommandBuffer& commands)
+	{
+		for (const auto& batch : this->batches)
+		{
+			if (batch.Layer == layer)
+			{
+				commands.Add(batch.Renderer, this->modelMatrix);
+			}
+		}
+	}
+
+	const GLStaticBatchStats& GetStats()
+	{
+		return this->stats;
+	}
+
+private:
+	struct GLStaticObject
+	{
+		GLGameObject* Object;
+		GLMeshRenderer* Renderer;
+		const glm::mat4* Model;
+	};
+
+	struct GLStaticBatch
+	{
+		std::string Layer;
+		GLSharedPtr<GLMeshRenderer> Renderer;
+	};
+
+	// Layer, material, face culling and chunk.
+	typedef std::tuple<std::string, GLMaterial*, bool, int, int, int> GLStaticBatchKey;
+
+	struct GLStaticCandidate
+	{
+		GLStaticBatchKey Key;
+		GLStaticObject Object;
+	};
+
+	void Rebuild(const GLSharedPtr<GLGameObject>& root)
+	{
+		this->batches.clear();
+		this->groups.clear();
+		this->candidates.clear();
+		this->meshUses.clear();
+
+		this->Collect(root.get(), root->GetLayer());
+
+		for (const auto& candidate : this->candidates)
+		{
+			if (this->meshUses[candidate.Object.Renderer->GetMesh().get()] < GLRenderQueue::MIN_INSTANCE_COUNT)
+			{
+				this->groups[candidate.Key].push_back(candidate.Object);
+			}
+		}
+
+		size_t objects = 0;
+		size_t vertices = 0;
+
+		for (auto& group : this->groups)
+		{
+			// Nothing is gained by merging a single mesh.
+			if (group.second.size() < 2)
+			{
+				continue;
+			}
+
+			const auto& key = group.first;
+
+			auto renderer = GLCreate<GLMeshRenderer>();
+			renderer->SetMaterial(group.second[0].Renderer->GetMaterial());
+			renderer->SetCullFace(std::get<2>(key));
+
+			const auto& mesh = renderer->GetMesh();
+
+			for (const auto& object : group.second)
+			{
+				Append(mesh, object.Renderer->GetMesh(), *object.Model);
+				object.Object->SetStaticBatched(true);
+			}
+
+			mesh->Update();
+
+			this->batches.push_back({ std::get<0>(key), renderer });
+
+			objects += group.second.size();
+			vertices += mesh->GetIndexCount();
+		}
+
+		this->groups.clear();
+		this->candidates.clear();
+		this->meshUses.clear();
+
+		this->stats.Rebuilds++;
+		this->stats.Batches = this->batches.size();
+		this->stats.Objects = objects;
+		this->stats.Vertices = vertices;
+	}
+
+	// Walks the tree like GLGameObject::Enqueue, only objects drawn for the layer of their parents count.
+	void Collect(GLGameObject* object, const std::string& layer)
+	{
+		object->SetStaticBatched(false);
+
+		const auto& transform = object->GetTransform();
+
+		if (transform == nullptr)
+		{
+			return;
+		}
+
+		transform->Update();
+
+		if (object->GetLayer() != layer || !object->IsVisible())
+		{
+			return;
+		}
+
+		for (const auto& child : object->Children)
+		{
+			this->Collect(child.get(), layer);
+		}
+
+		const auto& renderer = object->GetMeshRenderer();
+
+		if (!object->IsStatic() || renderer == nullptr || !renderer->IsOpaque())
+		{
+			return;
+		}
+
+		const auto& mesh = renderer->GetMesh();
+
+		if (mesh == nullptr || mesh->GetDrawMode() != GLMeshDrawMode::Triangle || mesh->GetIndexCount() == 0)
+		{
+			return;
+		}
+
+		bool bCullFace = renderer->DoCullFace() && !mesh->IsDoubleSided();
+
+		glm::vec3 center;
+		float radius;
+
+		renderer->GetWorldSphere(transform->LocalToWorldMatrix, center, radius);
+
+		glm::ivec3 chunk = glm::ivec3(glm::floor(center / this->chunkSize));
+
+		GLStaticBatchKey key(layer, renderer->GetMaterial().get(), bCullFace, chunk.x, chunk.y, chunk.z);
+
+		this->candidates.push_back({ key, { object, renderer.get(), &transform->LocalToWorldMatrix } });
+		this->meshUses[mesh.get()]++;
+	}
+
+	// Positions are indexed while colors, normals and uvs are stored per index, see GLMesh.
+	// Attributes the source lacks are padded so they stay aligned with the indices.
+	static void Append(const GLSharedPtr<GLMesh>& target, const GLSharedPtr<GLMesh>& source, const glm::mat4& modelMatrix)
+	{
+		glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(modelMatrix)));
+
+		GLuint firstVertex = (GLuint)target->GetVertexCount();
+		size_t indexCount = source->GetIndexCount();
+
+		for (const auto& vertex : source->GetVertices())
+		{
+			target->GetVertices().push_back(glm::vec3(modelMatrix * glm::vec4(vertex, 1.0f)));
+		}
+
+		for (auto index : source->GetIndices())
+		{
+			target->GetIndices().push_back(firstVertex + index);
+		}
+
+		const auto& colors = source->GetColors();
+		const auto& normals = source->GetNormals();
+		const auto& uvs = source->GetUVs();
+
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			target->GetColors().push_back(i < colors.size() ? colors[i] : GLColor(1.0f, 1.0f, 1.0f));
+			target->GetNormals().push_back(i < normals.size() ? normalMatrix * normals[i] : glm::vec3(0.0f));
+			target->GetUVs().push_back(i < uvs.size() ? uvs[i] : glm::vec2(0.0f));
+		}
+	}
+
+	float chunkSize = 32.0f;
+
+	std::vector<GLStaticBatch> batches;
+	std::map<GLStaticBatchKey, std::vector<GLStaticObject>> groups;
+	std::vector<GLStaticCandidate> candidates;
+	std::unordered_map<GLMesh*, size_t> meshUses;
+
+	unsigned int version = 0;
+	bool bBuilt = false;
+
+	// Batches are in world space.
+	glm::mat4 modelMatrix = glm::mat4(1.0f);
+
+	GLStaticBatchStats stats;
+};
\ No newline at end of file
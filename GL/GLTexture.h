@@ -2,30 +2,30 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <cmath>
+#include <climits>
 #include <unordered_map>
 
 #include <gl/glew.h>
 
+#include "GLTextureBinder.h"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "core/std_image.h"
 
+// Image storage only. Filtering and wrapping come from the GLSampler bound with it.
 class GLTexture
 {
 public:
     GLTexture()
     {
-        glGenTextures(1, &this->id);
-        glBindTexture(GL_TEXTURE_2D, this->id);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        this->Create();
     }
 
     virtual ~GLTexture()
     {
-        glDeleteTextures(1, &this->id);
+        this->Unload();
     }
 
     unsigned int GetId()
@@ -48,10 +48,79 @@ public:
         return this->channels;
     }
 
-    void Use()
+    const std::string& GetFileName()
+    {
+        return this->fileName;
+    }
+
+    bool IsResident()
+    {
+        return this->bResident;
+    }
+
+    unsigned long long GetLastUsedTick()
+    {
+        return this->lastUsedTick;
+    }
+
+    void Touch()
+    {
+        this->lastUsedTick = ++useTick;
+    }
+
+    // Size of the texture storage in video memory, including the full mip chain.
+    size_t GetByteSize()
+    {
+        if (!this->bResident || this->width == 0 || this->height == 0)
+        {
+            return 0;
+        }
+
+        size_t byteSize = 0;
+
+        for (int level = this->baseLevel; level < this->GetLevelCount(); ++level)
+        {
+            byteSize += this->GetLevelByteSize(level);
+        }
+
+        return byteSize;
+    }
+
+    int GetLevelCount()
+    {
+        int size = this->width > this->height ? this->width : this->height;
+        int levelCount = 1;
+
+        while (size > 1)
+        {
+            size /= 2;
+            levelCount++;
+        }
+
+        return levelCount;
+    }
+
+    size_t GetLevelByteSize(int level)
     {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, this->id);
+        int levelWidth = this->width >> level;
+        int levelHeight = this->height >> level;
+
+        levelWidth = levelWidth > 0 ? levelWidth : 1;
+        levelHeight = levelHeight > 0 ? levelHeight : 1;
+
+        return (size_t)levelWidth * (size_t)levelHeight * GetComponentCount(this->colorMode) * GetComponentSize(this->pixelType);
+    }
+
+    void Use(int unit = 0)
+    {
+        if (!this->bResident)
+        {
+            this->Reload();
+        }
+
+        this->Touch();
+
+        GLTextureBinder::Bind(unit, GL_TEXTURE_2D, this->id);
     }
 
     void Load(const std::string& fileName, GLenum colorMode = GL_RGB, GLenum pixelType = GL_UNSIGNED_BYTE)
@@ -60,11 +129,229 @@ public:
 
         assert(data != NULL);
 
-        glBindTexture(GL_TEXTURE_2D, this->id);
-        glTexImage2D(GL_TEXTURE_2D, 0, colorMode , this->width, this->height, 0, colorMode, pixelType, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        if (!this->bResident)
+        {
+            this->Create();
+        }
+
+        this->fileName = fileName;
+        this->colorMode = colorMode;
+        this->pixelType = pixelType;
+
+        if (this->bStreaming && pixelType == GL_UNSIGNED_BYTE)
+        {
+            this->BuildMipChain(data);
+
+            this->baseLevel = this->GetMinimumResidentLevel();
+            this->UploadLevels(this->baseLevel, this->GetLevelCount() - 1);
+        }
+        else
+        {
+            this->mipData.clear();
+            this->baseLevel = 0;
+
+            GLTextureBinder::BindForUpdate(GL_TEXTURE_2D, this->id);
+            glTexImage2D(GL_TEXTURE_2D, 0, colorMode , this->width, this->height, 0, colorMode, pixelType, data);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
 
         stbi_image_free(data);
+
+        this->requestedLevel = INT_MAX;
+        this->bResident = true;
+    }
+
+    // Restores the video memory storage released by Unload. Streamed textures restart
+    // from their lowest levels using the decoded mip chain, others reload the original file.
+    void Reload()
+    {
+        if (this->bResident || this->fileName.empty())
+        {
+            return;
+        }
+
+        if (this->mipData.size() > 0)
+        {
+            this->Create();
+
+            this->baseLevel = this->GetMinimumResidentLevel();
+            this->UploadLevels(this->baseLevel, this->GetLevelCount() - 1);
+        }
+        else
+        {
+            this->Load(this->fileName, this->colorMode, this->pixelType);
+        }
+
+        this->reloadCount++;
+    }
+
+    // Releases the video memory storage. The texture keeps its file name so it can be reloaded later.
+    void Unload()
+    {
+        if (!this->bResident)
+        {
+            return;
+        }
+
+        glDeleteTextures(1, &this->id);
+        GLTextureBinder::Forget(this->id);
+
+        this->id = -1;
+        this->bResident = false;
+    }
+
+    unsigned int GetReloadCount()
+    {
+        return this->reloadCount;
+    }
+
+    bool IsStreaming()
+    {
+        return this->mipData.size() > 0;
+    }
+
+    // Streaming must be enabled before Load. Only the levels no larger than the minimum
+    // resident size are uploaded at first, higher levels are streamed in on request.
+    void SetStreaming(bool streaming)
+    {
+        this->bStreaming = streaming;
+    }
+
+    int GetBaseLevel()
+    {
+        return this->baseLevel;
+    }
+
+    int GetMinimumResidentLevel()
+    {
+        int level = 0;
+
+        while (level < this->GetLevelCount() - 1 &&
+            ((this->width >> level) > minimumResidentSize || (this->height >> level) > minimumResidentSize))
+        {
+            level++;
+        }
+
+        return level;
+    }
+
+    // Records the on-screen size in pixels the texture is drawn at. The finest level
+    // requested since the last ResetRequest becomes the streaming target.
+    void RequestScreenSize(float pixels)
+    {
+        int size = this->width > this->height ? this->width : this->height;
+        int level = this->GetLevelCount() - 1;
+
+        if (pixels >= size)
+        {
+            level = 0;
+        }
+        else if (pixels > 1.0f)
+        {
+            level = (int)std::floor(std::log2(size / pixels));
+        }
+
+        if (level < this->requestedLevel)
+        {
+            this->requestedLevel = level;
+        }
+    }
+
+    int GetRequestedLevel()
+    {
+        return this->requestedLevel;
+    }
+
+    // Level the texture should have resident, never coarser than the minimum resident level.
+    int GetTargetLevel()
+    {
+        int minimumLevel = this->GetMinimumResidentLevel();
+
+        return this->requestedLevel < minimumLevel ? this->requestedLevel : minimumLevel;
+    }
+
+    void ResetRequest()
+    {
+        this->requestedLevel = INT_MAX;
+    }
+
+    // Uploads the next finer level. Returns the number of bytes added.
+    size_t StreamIn()
+    {
+        if (!this->bResident || !this->IsStreaming() || this->baseLevel == 0)
+        {
+            return 0;
+        }
+
+        this->UploadLevels(this->baseLevel - 1, this->baseLevel - 1);
+
+        return this->GetLevelByteSize(this->baseLevel);
+    }
+
+    // Releases every level finer than the given one. Returns the number of bytes freed.
+    size_t DropTo(int level)
+    {
+        if (!this->bResident || !this->IsStreaming() || level <= this->baseLevel)
+        {
+            return 0;
+        }
+
+        size_t freedBytes = 0;
+
+        GLTextureBinder::BindForUpdate(GL_TEXTURE_2D, this->id);
+
+        for (int i = this->baseLevel; i < level; ++i)
+        {
+            glTexImage2D(GL_TEXTURE_2D, i, this->colorMode, 0, 0, 0, this->colorMode, this->pixelType, NULL);
+            freedBytes += this->GetLevelByteSize(i);
+        }
+
+        this->SetBaseLevel(level);
+
+        return freedBytes;
+    }
+
+    static int GetMinimumResidentSize()
+    {
+        return minimumResidentSize;
+    }
+
+    static void SetMinimumResidentSize(int size)
+    {
+        minimumResidentSize = size;
+    }
+
+    static size_t GetComponentCount(GLenum colorMode)
+    {
+        switch (colorMode)
+        {
+        case GL_RED:
+        case GL_DEPTH_COMPONENT:
+            return 1;
+        case GL_RG:
+            return 2;
+        case GL_RGB:
+        case GL_BGR:
+            return 3;
+        default:
+            return 4;
+        }
+    }
+
+    static size_t GetComponentSize(GLenum pixelType)
+    {
+        switch (pixelType)
+        {
+        case GL_UNSIGNED_BYTE:
+        case GL_BYTE:
+            return 1;
+        case GL_UNSIGNED_SHORT:
+        case GL_SHORT:
+        case GL_HALF_FLOAT:
+            return 2;
+        default:
+            return 4;
+        }
     }
 
     unsigned int id = -1;
@@ -72,4 +359,112 @@ public:
     int width = 0;
     int height = 0;
     int channels = 0;
-};
\ No newline at end of file
+
+private:
+    void Create()
+    {
+        glGenTextures(1, &this->id);
+        GLTextureBinder::BindForUpdate(GL_TEXTURE_2D, this->id);
+
+        this->bResident = true;
+    }
+
+    void SetBaseLevel(int level)
+    {
+        this->baseLevel = level;
+
+        GLTextureBinder::BindForUpdate(GL_TEXTURE_2D, this->id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, this->GetLevelCount() - 1);
+    }
+
+    void UploadLevels(int firstLevel, int lastLevel)
+    {
+        GLTextureBinder::BindForUpdate(GL_TEXTURE_2D, this->id);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        for (int level = firstLevel; level <= lastLevel; ++level)
+        {
+            int levelWidth = this->width >> level;
+            int levelHeight = this->height >> level;
+
+            levelWidth = levelWidth > 0 ? levelWidth : 1;
+            levelHeight = levelHeight > 0 ? levelHeight : 1;
+
+            glTexImage2D(GL_TEXTURE_2D, level, this->colorMode, levelWidth, levelHeight, 0, this->colorMode, this->pixelType, this->mipData[level].data());
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        this->SetBaseLevel(firstLevel < this->baseLevel ? firstLevel : this->baseLevel);
+    }
+
+    // Box filters the decoded image down to 1x1 and keeps every level in system memory.
+    void BuildMipChain(const unsigned char* data)
+    {
+        int levelCount = this->GetLevelCount();
+
+        this->mipData.assign(levelCount, std::vector<unsigned char>());
+        this->mipData[0].assign(data, data + (size_t)this->width * this->height * this->channels);
+
+        for (int level = 1; level < levelCount; ++level)
+        {
+            int sourceWidth = this->width >> (level - 1);
+            int sourceHeight = this->height >> (level - 1);
+
+            sourceWidth = sourceWidth > 0 ? sourceWidth : 1;
+            sourceHeight = sourceHeight > 0 ? sourceHeight : 1;
+
+            int levelWidth = sourceWidth > 1 ? sourceWidth / 2 : 1;
+            int levelHeight = sourceHeight > 1 ? sourceHeight / 2 : 1;
+
+            const auto& source = this->mipData[level - 1];
+            auto& destination = this->mipData[level];
+
+            destination.resize((size_t)levelWidth * levelHeight * this->channels);
+
+            for (int y = 0; y < levelHeight; ++y)
+            {
+                int y0 = y * 2;
+                int y1 = y0 + 1 < sourceHeight ? y0 + 1 : y0;
+
+                for (int x = 0; x < levelWidth; ++x)
+                {
+                    int x0 = x * 2;
+                    int x1 = x0 + 1 < sourceWidth ? x0 + 1 : x0;
+
+                    for (int c = 0; c < this->channels; ++c)
+                    {
+                        int sum =
+                            source[((size_t)y0 * sourceWidth + x0) * this->channels + c] +
+                            source[((size_t)y0 * sourceWidth + x1) * this->channels + c] +
+                            source[((size_t)y1 * sourceWidth + x0) * this->channels + c] +
+                            source[((size_t)y1 * sourceWidth + x1) * this->channels + c];
+
+                        destination[((size_t)y * levelWidth + x) * this->channels + c] = (unsigned char)((sum + 2) / 4);
+                    }
+                }
+            }
+        }
+    }
+
+    std::string fileName;
+    GLenum colorMode = GL_RGB;
+    GLenum pixelType = GL_UNSIGNED_BYTE;
+
+    bool bResident = false;
+    unsigned int reloadCount = 0;
+    unsigned long long lastUsedTick = 0;
+
+    bool bStreaming = false;
+    std::vector<std::vector<unsigned char>> mipData;
+
+    int baseLevel = 0;
+    int requestedLevel = INT_MAX;
+
+    static unsigned long long useTick;
+    static int minimumResidentSize;
+};
+
+unsigned long long GLTexture::useTick = 0;
+int GLTexture::minimumResidentSize = 64;
\ No newline at end of file
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <gl/glew.h>
+
+#include "GLMemoryHelpers.h"
+#include "GLTextureBinder.h"
+#include "GLTexture.h"
+
+class GLTextureArray
+{
+public:
+	GLTextureArray(int width, int height, int capacity, GLenum colorMode = GL_RGB, GLenum pixelType = GL_UNSIGNED_BYTE)
+		: width(width), height(height), capacity(capacity), colorMode(colorMode), pixelType(pixelType)
+	{
+		glGenTextures(1, &this->id);
+		GLTextureBinder::BindForUpdate(GL_TEXTURE_2D_ARRAY, this->id);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, colorMode, width, height, capacity, 0, colorMode, pixelType, NULL);
+	}
+
+	virtual ~GLTextureArray()
+	{
+		glDeleteTextures(1, &this->id);
+		GLTextureBinder::Forget(this->id);
+	}
+
+	unsigned int GetId()
+	{
+		return this->id;
+	}
+
+	int GetWidth()
+	{
+		return this->width;
+	}
+
+	int GetHeight()
+	{
+		return this->height;
+	}
+
+	int GetCapacity()
+	{
+		return this->capacity;
+	}
+
+	int GetLayerCount()
+	{
+		return this->layerCount;
+	}
+
+	bool IsFull()
+	{
+		return this->layerCount >= this->capacity;
+	}
+
+	bool IsCompatible(int width, int height, GLenum colorMode, GLenum pixelType)
+	{
+		return this->width == width && this->height == height && this->colorMode == colorMode && this->pixelType == pixelType;
+	}
+
+	// Size of the storage in video memory, every layer with its mip chain.
+	size_t GetByteSize()
+	{
+		size_t layerBytes = 0;
+
+		int levelWidth = this->width;
+		int levelHeight = this->height;
+
+		while (true)
+		{
+			layerBytes += (size_t)levelWidth * (size_t)levelHeight;
+
+			if (levelWidth == 1 && levelHeight == 1)
+			{
+				break;
+			}
+
+			levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+			levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+		}
+
+		return layerBytes * this->capacity * GLTexture::GetComponentCount(this->colorMode) * GLTexture::GetComponentSize(this->pixelType);
+	}
+
+	// Moves the layers into new storage for capacity layers. The texture id changes, so it has
+	// to be read from the array again after growing.
+	void Grow(int capacity)
+	{
+		if (capacity <= this->capacity)
+		{
+			return;
+		}
+
+		unsigned int previousId = this->id;
+
+		glGenTextures(1, &this->id);
+		GLTextureBinder::BindForUpdate(GL_TEXTURE_2D_ARRAY, this->id);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, this->colorMode, this->width, this->height, capacity, 0, this->colorMode, this->pixelType, NULL);
+
+		// Layers are copied through a read framebuffer, available wherever texture arrays are.
+		unsigned int framebufferId;
+		glGenFramebuffers(1, &framebufferId);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebufferId);
+
+		for (int layer = 0; layer < this->layerCount; ++layer)
+		{
+			glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, previousId, 0, layer);
+			glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, 0, 0, this->width, this->height);
+		}
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebufferId);
+
+		glDeleteTextures(1, &previousId);
+		GLTextureBinder::Forget(previousId);
+
+		this->capacity = capacity;
+		this->bMipsDirty = true;
+	}
+
+	// Uploads the pixels into the next free layer and returns its index, or -1 when full.
+	// The mips are built once for all layers added before the next Use.
+	int AddLayer(const void* data)
+	{
+		if (this->IsFull())
+		{
+			return -1;
+		}
+
+		int layer = this->layerCount++;
+
+		GLTextureBinder::BindForUpdate(GL_TEXTURE_2D_ARRAY, this->id);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, this->width, this->height, 1, this->colorMode, this->pixelType, data);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		this->bMipsDirty = true;
+
+		return layer;
+	}
+
+	void Use(int unit = 0)
+	{
+		GLTextureBinder::Bind(unit, GL_TEXTURE_2D_ARRAY, this->id);
+
+		if (this->bMipsDirty)
+		{
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+			this->bMipsDirty = false;
+		}
+	}
+
+private:
+	unsigned int id = -1;
+
+	int width = 0;
+	int height = 0;
+	int capacity = 0;
+	int layerCount = 0;
+
+	bool bMipsDirty = false;
+
+	GLenum colorMode = GL_RGB;
+	GLenum pixelType = GL_UNSIGNED_BYTE;
+};
+
+struct GLTextureLayer
+{
+	GLSharedPtr<GLTextureArray> Array = nullptr;
+	int Layer = -1;
+};
+
+// Groups images of the same size and format into shared texture arrays, so materials
+// that differ only by their diffuse image can be drawn without rebinding textures.
+// Arrays start with one layer and double as images are added, up to the array capacity.
+// Their memory counts against the GLTextureLoader budget, which releases arrays no material
+// uses any more.
+class GLTextureArrayPool
+{
+public:
+	static GLTextureLayer Load(const std::string& fileName, GLenum colorMode = GL_RGB, GLenum pixelType = GL_UNSIGNED_BYTE)
+	{
+		auto position = loadedLayers.find(fileName);
+
+		if (position != loadedLayers.end())
+		{
+			return position->second;
+		}
+
+		int width, height, channels;
+		unsigned char* data = stbi_load(fileName.c_str(), &width, &height, &channels, 0);
+
+		assert(data != NULL);
+
+		GLTextureLayer textureLayer;
+		textureLayer.Array = GetArray(width, height, colorMode, pixelType);
+		textureLayer.Layer = textureLayer.Array->AddLayer(data);
+
+		stbi_image_free(data);
+
+		loadedLayers[fileName] = textureLayer;
+
+		return textureLayer;
+	}
+
+	// Most layers in one array.
+	static int GetArrayCapacity()
+	{
+		return arrayCapacity;
+	}
+
+	static void SetArrayCapacity(int capacity)
+	{
+		arrayCapacity = capacity;
+	}
+
+	static size_t GetArrayCount()
+	{
+		return arrays.size();
+	}
+
+	static size_t GetResidentBytes()
+	{
+		size_t residentBytes = 0;
+
+		for (auto& array : arrays)
+		{
+			residentBytes += array->GetByteSize();
+		}
+
+		return residentBytes;
+	}
+
+	// Releases the arrays only referenced by the pool, their images are loaded again when
+	// requested. Returns the number of bytes freed.
+	static size_t ReleaseUnused()
+	{
+		size_t freedBytes = 0;
+
+		for (auto array = arrays.begin(); array != arrays.end();)
+		{
+			// The pool holds one reference in the array list and one per loaded layer.
+			long poolReferences = 1;
+
+			for (auto& entry : loadedLayers)
+			{
+				poolReferences += entry.second.Array == *array ? 1 : 0;
+			}
+
+			if (array->use_count() > poolReferences)
+			{
+				++array;
+				continue;
+			}
+
+			for (auto entry = loadedLayers.begin(); entry != loadedLayers.end();)
+			{
+				entry = entry->second.Array == *array ? loadedLayers.erase(entry) : std::next(entry);
+			}
+
+			freedBytes += (*array)->GetByteSize();
+			array = arrays.erase(array);
+		}
+
+		return freedBytes;
+	}
+
+private:
+	static GLSharedPtr<GLTextureArray> GetArray(int width, int height, GLenum colorMode, GLenum pixelType)
+	{
+		for (auto& array : arrays)
+		{
+			if (!array->IsCompatible(width, height, colorMode, pixelType) || array->GetLayerCount() >= arrayCapacity)
+			{
+				continue;
+			}
+
+			if (array->IsFull())
+			{
+				array->Grow(std::min(array->GetCapacity() * 2, arrayCapacity));
+			}
+
+			return array;
+		}
+
+		auto array = GLCreate<GLTextureArray>(width, height, 1, colorMode, pixelType);
+		arrays.push_back(array);
+
+		return array;
+	}
+
+	static std::vector<GLSharedPtr<GLTextureArray>> arrays;
+	static std::unordered_map<std::string, GLTextureLayer> loadedLayers;
+
+	static int arrayCapacity;
+};
+
+std::vector<GLSharedPtr<GLTextureArray>> GLTextureArrayPool::arrays;
+std::unordered_map<std::string, GLTextureLayer> GLTextureArrayPool::loadedLayers;
+
+int GLTextureArrayPool::arrayCapacity = 16;
\ No newline at end of file
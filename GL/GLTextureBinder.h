@@ -0,0 +1,165 @@
+#pragma once
+
+#include <gl/glew.h>
+
+struct GLTextureBindStats
+{
+	size_t Binds = 0;
+	size_t Skipped = 0;
+	size_t UnitSwitches = 0;
+
+	size_t SamplerBinds = 0;
+	size_t SamplersSkipped = 0;
+};
+
+// Shadow copy of the texture and sampler unit bindings. Every engine texture bind goes
+// through it so binds of a texture that is already bound to the unit are skipped.
+class GLTextureBinder
+{
+public:
+	static const int MAX_TEXTURE_UNITS = 32;
+
+	static void Bind(int unit, GLenum target, unsigned int id)
+	{
+		int targetIndex = GetTargetIndex(target);
+
+		if (targetIndex >= 0 && bindings[unit][targetIndex] == id)
+		{
+			stats.Skipped++;
+			return;
+		}
+
+		SetActiveUnit(unit);
+		glBindTexture(target, id);
+
+		if (targetIndex >= 0)
+		{
+			bindings[unit][targetIndex] = id;
+		}
+
+		stats.Binds++;
+	}
+
+	// Binds on whatever unit is active, for texture uploads and parameter changes.
+	static void BindForUpdate(GLenum target, unsigned int id)
+	{
+		Bind(activeUnit >= 0 ? activeUnit : 0, target, id);
+	}
+
+	static void BindSampler(int unit, unsigned int id)
+	{
+		if (samplerBindings[unit] == id)
+		{
+			stats.SamplersSkipped++;
+			return;
+		}
+
+		glBindSampler(unit, id);
+		samplerBindings[unit] = id;
+
+		stats.SamplerBinds++;
+	}
+
+	static void SetActiveUnit(int unit)
+	{
+		if (activeUnit == unit)
+		{
+			return;
+		}
+
+		glActiveTexture(GL_TEXTURE0 + unit);
+		activeUnit = unit;
+
+		stats.UnitSwitches++;
+	}
+
+	static unsigned int GetBound(int unit, GLenum target)
+	{
+		int targetIndex = GetTargetIndex(target);
+
+		return targetIndex >= 0 ? bindings[unit][targetIndex] : 0;
+	}
+
+	// Deleted textures are unbound from every unit by GL.
+	static void Forget(unsigned int id)
+	{
+		for (int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+		{
+			for (int targetIndex = 0; targetIndex < TARGET_COUNT; ++targetIndex)
+			{
+				if (bindings[unit][targetIndex] == id)
+				{
+					bindings[unit][targetIndex] = 0;
+				}
+			}
+		}
+	}
+
+	static void ForgetSampler(unsigned int id)
+	{
+		for (int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+		{
+			if (samplerBindings[unit] == id)
+			{
+				samplerBindings[unit] = 0;
+			}
+		}
+	}
+
+	// Must be called after texture state was changed without going through the binder.
+	static void Invalidate()
+	{
+		for (int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+		{
+			for (int targetIndex = 0; targetIndex < TARGET_COUNT; ++targetIndex)
+			{
+				bindings[unit][targetIndex] = INVALID_BINDING;
+			}
+
+			samplerBindings[unit] = INVALID_BINDING;
+		}
+
+		activeUnit = -1;
+	}
+
+	static GLTextureBindStats GetStats()
+	{
+		return stats;
+	}
+
+	static void ResetStats()
+	{
+		stats = GLTextureBindStats();
+	}
+
+private:
+	static const int TARGET_COUNT = 3;
+	static const unsigned int INVALID_BINDING = 0xFFFFFFFF;
+
+	static int GetTargetIndex(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_TEXTURE_2D:
+			return 0;
+		case GL_TEXTURE_2D_ARRAY:
+			return 1;
+		case GL_TEXTURE_BUFFER:
+			return 2;
+		default:
+			return -1;
+		}
+	}
+
+	static unsigned int bindings[MAX_TEXTURE_UNITS][TARGET_COUNT];
+	static unsigned int samplerBindings[MAX_TEXTURE_UNITS];
+	static int activeUnit;
+
+	static GLTextureBindStats stats;
+};
+
+unsigned int GLTextureBinder::bindings[GLTextureBinder::MAX_TEXTURE_UNITS][GLTextureBinder::TARGET_COUNT] = { };
+unsigned int GLTextureBinder::samplerBindings[GLTextureBinder::MAX_TEXTURE_UNITS] = { };
+int GLTextureBinder::activeUnit = 0;
+
+GLTextureBindStats GLTextureBinder::stats;
\ No newline at end of file
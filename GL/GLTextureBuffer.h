@@ -0,0 +1,83 @@
+#pragma once
+
+#include <gl/glew.h>
+
+#include "GLMemoryHelpers.h"
+#include "GLTextureBinder.h"
+#include "GLStateCache.h"
+
+// Buffer read in shaders through a samplerBuffer, for arrays too large for a uniform block.
+// Every texel has the given sized format, e.g. GL_RGBA32F or GL_R32I.
+class GLTextureBuffer
+{
+public:
+	GLTextureBuffer(GLenum format, GLsizeiptr capacity = 256)
+		: format(format), capacity(capacity)
+	{
+		glGenBuffers(1, &this->bufferId);
+
+		GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, this->bufferId);
+		glBufferData(GL_TEXTURE_BUFFER, capacity, NULL, GL_DYNAMIC_DRAW);
+
+		glGenTextures(1, &this->textureId);
+		GLTextureBinder::BindForUpdate(GL_TEXTURE_BUFFER, this->textureId);
+		glTexBuffer(GL_TEXTURE_BUFFER, format, this->bufferId);
+	}
+
+	virtual ~GLTextureBuffer()
+	{
+		glDeleteTextures(1, &this->textureId);
+		GLTextureBinder::Forget(this->textureId);
+
+		glDeleteBuffers(1, &this->bufferId);
+		GLStateCache::ForgetBuffer(this->bufferId);
+	}
+
+	// Replaces the contents. The storage only grows, to twice the size needed.
+	void Update(const void* data, GLsizeiptr size)
+	{
+		GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, this->bufferId);
+
+		if (size > this->capacity)
+		{
+			this->capacity = size * 2;
+			glBufferData(GL_TEXTURE_BUFFER, this->capacity, NULL, GL_DYNAMIC_DRAW);
+		}
+
+		if (size > 0)
+		{
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+		}
+
+		this->size = size;
+	}
+
+	void Bind(int unit)
+	{
+		GLTextureBinder::Bind(unit, GL_TEXTURE_BUFFER, this->textureId);
+	}
+
+	GLuint GetTextureId()
+	{
+		return this->textureId;
+	}
+
+	GLuint GetBufferId()
+	{
+		return this->bufferId;
+	}
+
+	GLsizeiptr GetSize()
+	{
+		return this->size;
+	}
+
+private:
+	GLuint bufferId = 0;
+	GLuint textureId = 0;
+
+	GLenum format;
+
+	GLsizeiptr capacity = 0;
+	GLsizeiptr size = 0;
+};
\ No newline at end of file
@@ -2,32 +2,255 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <unordered_map>
 
 #include "GLMemoryHelpers.h"
 #include "GLTexture.h"
+#include "GLTextureArray.h"
+
+struct GLTextureCacheStats
+{
+    size_t Hits = 0;
+    size_t Misses = 0;
+    size_t Evictions = 0;
+    size_t Reloads = 0;
+
+    size_t StreamedLevels = 0;
+    size_t DroppedLevels = 0;
+
+    // Includes the texture arrays of the GLTextureArrayPool.
+    size_t ResidentBytes = 0;
+    size_t ArrayBytes = 0;
+    size_t BudgetBytes = 0;
+};
 
 class GLTextureLoader
 {
 public:
     static GLSharedPtr<GLTexture> Load(const std::string& fileName, GLenum colorMode = GL_RGB, GLenum pixelType = GL_UNSIGNED_BYTE)
     {
-        if (loadedTextures.find(fileName) != loadedTextures.end())
+        auto position = loadedTextures.find(fileName);
+
+        if (position != loadedTextures.end())
         {
-            return loadedTextures[fileName];
+            auto texture = position->second;
+
+            if (texture->IsResident())
+            {
+                stats.Hits++;
+            }
+            else
+            {
+                stats.Misses++;
+                stats.Reloads++;
+                texture->Reload();
+            }
+
+            texture->Touch();
+
+            Trim();
+
+            return texture;
         }
 
+        stats.Misses++;
+
         auto texture = GLCreate<GLTexture>();
+        texture->SetStreaming(bStreaming);
         texture->Load(fileName, colorMode, pixelType);
+        texture->Touch();
 
         loadedTextures[fileName] = texture;
 
+        Trim();
+
         return texture;
     }
 
+    // Evicts least recently used textures that are only referenced by the cache until
+    // the resident size fits into the budget. Evicted textures keep their cache entry
+    // and are reloaded from disk the next time they are requested or used. Texture arrays
+    // no material uses any more are released first.
+    static void Trim()
+    {
+        size_t residentBytes = GetResidentBytes();
+
+        if (residentBytes <= budgetBytes)
+        {
+            return;
+        }
+
+        size_t arrayCount = GLTextureArrayPool::GetArrayCount();
+
+        residentBytes -= GLTextureArrayPool::ReleaseUnused();
+
+        stats.Evictions += arrayCount - GLTextureArrayPool::GetArrayCount();
+
+        std::vector<GLTexture*> candidates;
+
+        for (auto& entry : loadedTextures)
+        {
+            if (entry.second->IsResident() && entry.second.use_count() == 1)
+            {
+                candidates.push_back(entry.second.get());
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(),
+            [](GLTexture* a, GLTexture* b)
+            {
+                return a->GetLastUsedTick() < b->GetLastUsedTick();
+            }
+        );
+
+        for (auto texture : candidates)
+        {
+            if (residentBytes <= budgetBytes)
+            {
+                break;
+            }
+
+            residentBytes -= texture->GetByteSize();
+            texture->Unload();
+
+            stats.Evictions++;
+        }
+    }
+
+    static size_t GetResidentBytes()
+    {
+        size_t residentBytes = GLTextureArrayPool::GetResidentBytes();
+
+        for (auto& entry : loadedTextures)
+        {
+            residentBytes += entry.second->GetByteSize();
+        }
+
+        return residentBytes;
+    }
+
+    static size_t GetBudget()
+    {
+        return budgetBytes;
+    }
+
+    static void SetBudget(size_t bytes)
+    {
+        budgetBytes = bytes;
+
+        Trim();
+    }
+
+    static GLTextureCacheStats GetStats()
+    {
+        GLTextureCacheStats current = stats;
+
+        current.ResidentBytes = GetResidentBytes();
+        current.ArrayBytes = GLTextureArrayPool::GetResidentBytes();
+        current.BudgetBytes = budgetBytes;
+
+        return current;
+    }
+
+    static bool IsStreaming()
+    {
+        return bStreaming;
+    }
+
+    // Applies to textures loaded after the call.
+    static void SetStreaming(bool streaming)
+    {
+        bStreaming = streaming;
+    }
+
+    // Called once per frame after rendering. Under memory pressure, textures nobody references
+    // any more are evicted first, then levels finer than what was requested this frame are
+    // dropped, then the textures furthest from their requested level stream in one level each,
+    // up to maxUploads levels per frame.
+    static void UpdateStreaming(int maxUploads = 4)
+    {
+        Trim();
+
+        size_t residentBytes = GetResidentBytes();
+
+        std::vector<GLTexture*> pending;
+
+        for (auto& entry : loadedTextures)
+        {
+            auto texture = entry.second.get();
+
+            if (!texture->IsStreaming() || !texture->IsResident())
+            {
+                continue;
+            }
+
+            int targetLevel = texture->GetTargetLevel();
+
+            if (targetLevel > texture->GetBaseLevel() && residentBytes > budgetBytes)
+            {
+                stats.DroppedLevels += targetLevel - texture->GetBaseLevel();
+                residentBytes -= texture->DropTo(targetLevel);
+            }
+            else if (targetLevel < texture->GetBaseLevel())
+            {
+                pending.push_back(texture);
+            }
+        }
+
+        std::sort(pending.begin(), pending.end(),
+            [](GLTexture* a, GLTexture* b)
+            {
+                return a->GetBaseLevel() - a->GetTargetLevel() > b->GetBaseLevel() - b->GetTargetLevel();
+            }
+        );
+
+        int uploads = 0;
+
+        for (auto texture : pending)
+        {
+            if (uploads >= maxUploads)
+            {
+                break;
+            }
+
+            size_t levelBytes = texture->GetLevelByteSize(texture->GetBaseLevel() - 1);
+
+            if (residentBytes + levelBytes > budgetBytes)
+            {
+                continue;
+            }
+
+            residentBytes += texture->StreamIn();
+
+            stats.StreamedLevels++;
+            uploads++;
+        }
+
+        for (auto& entry : loadedTextures)
+        {
+            entry.second->ResetRequest();
+        }
+    }
+
+    static void ResetStats()
+    {
+        stats = GLTextureCacheStats();
+    }
+
 private:
     static std::unordered_map<std::string, GLSharedPtr<GLTexture>> loadedTextures;
 
+    static size_t budgetBytes;
+    static GLTextureCacheStats stats;
+
+    static bool bStreaming;
 };
 
-std::unordered_map<std::string, GLSharedPtr<GLTexture>> GLTextureLoader::loadedTextures;
\ No newline at end of file
+std::unordered_map<std::string, GLSharedPtr<GLTexture>> GLTextureLoader::loadedTextures;
+
+size_t GLTextureLoader::budgetBytes = 256 * 1024 * 1024;
+GLTextureCacheStats GLTextureLoader::stats;
+
+bool GLTextureLoader::bStreaming = false;
\ No newline at end of file
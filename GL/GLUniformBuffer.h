@@ -0,0 +1,70 @@
+#pragma once
+
+#include <gl/glew.h>
+
+#include "GLMemoryHelpers.h"
+#include "GLShader.h"
+#include "GLStateCache.h"
+
+// Buffer backing a uniform block. Contents are laid out by the caller, std140 structs
+// are written as they are.
+class GLUniformBuffer
+{
+public:
+	GLUniformBuffer(GLsizeiptr size)
+		: size(size)
+	{
+		glGenBuffers(1, &this->bufferId);
+
+		GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, this->bufferId);
+		glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	}
+
+	virtual ~GLUniformBuffer()
+	{
+		glDeleteBuffers(1, &this->bufferId);
+		GLStateCache::ForgetBuffer(this->bufferId);
+	}
+
+	void Update(const void* data, GLsizeiptr dataSize, GLintptr offset = 0)
+	{
+		assert(offset + dataSize <= this->size);
+
+		GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, this->bufferId);
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, dataSize, data);
+	}
+
+	template <typename T>
+	void Update(const T& data)
+	{
+		this->Update(&data, sizeof(T));
+	}
+
+	// Grows the buffer, the contents are lost.
+	void Resize(GLsizeiptr size)
+	{
+		this->size = size;
+
+		GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, this->bufferId);
+		glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	}
+
+	void Bind(GLUniformBlockBinding binding)
+	{
+		GLStateCache::BindBufferBase(GL_UNIFORM_BUFFER, (GLuint)binding, this->bufferId);
+	}
+
+	GLuint GetId()
+	{
+		return this->bufferId;
+	}
+
+	GLsizeiptr GetSize()
+	{
+		return this->size;
+	}
+
+private:
+	GLuint bufferId = 0;
+	GLsizeiptr size = 0;
+};
\ No newline at end of file
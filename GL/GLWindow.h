@@ -2,11 +2,13 @@
 
 #include <string>
 
+#include <gl/glew.h>
 #include <gl/freeglut.h>
 #include <gl/freeglut_ext.h>
 #include <gl/glm/glm.hpp>
 
 #include "GLMemoryHelpers.h"
+#include "GLStateCache.h"
 
 class GLWindow
 {
@@ -50,7 +52,7 @@ public:
 	{
 		this->Position = position;
 
-		glViewport(this->Position.x, this->Position.y, this->Size.x, this->Size.y);
+		GLStateCache::SetViewport(this->Position.x, this->Position.y, this->Size.x, this->Size.y);
 	}
 
 	void SetPosition(int x, int y)
@@ -58,14 +60,14 @@ public:
 		this->Position.x = x;
 		this->Position.y = y;
 
-		glViewport(this->Position.x, this->Position.y, this->Size.x, this->Size.y);
+		GLStateCache::SetViewport(this->Position.x, this->Position.y, this->Size.x, this->Size.y);
 	}
 
 	void SetSize(const glm::tvec2<int>& position)
 	{
 		this->Position = position;
 
-		glViewport(this->Position.x, this->Position.y, this->Size.x, this->Size.y);
+		GLStateCache::SetViewport(this->Position.x, this->Position.y, this->Size.x, this->Size.y);
 	}
 
 	void SetSize(int w, int h)
@@ -73,7 +75,7 @@ public:
 		this->Size.x = w;
 		this->Size.y = h;
 
-		glViewport(this->Position.x, this->Position.y, this->Size.x, this->Size.y);
+		GLStateCache::SetViewport(this->Position.x, this->Position.y, this->Size.x, this->Size.y);
 	}
 private:
 	int Id;
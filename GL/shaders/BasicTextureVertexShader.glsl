@@ -8,13 +8,13 @@ layout(location = 3) in vec2 inUV;
 out vec4 outColor;
 out vec2 texCoords;
 
+#include "Camera.glsl"
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
-    gl_Position = projection * view * model * inPosition;
+    gl_Position = camera.viewProjection * model * inPosition;
     outColor = inColor;
 
     texCoords = inUV;
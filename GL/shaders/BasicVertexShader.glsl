@@ -1,5 +1,9 @@
 #version 330 core
 
+#if defined(MULTI_DRAW)
+#include "DrawData.glsl"
+#endif
+
 layout(location = 0) in vec4 inPosition;
 layout(location = 1) in vec4 inColor;
 layout(location = 2) in vec4 inNormal;
@@ -7,12 +11,24 @@ layout(location = 3) in vec2 inUV;
 
 out vec4 outColor;
 
+#include "Camera.glsl"
+
+#if defined(INSTANCED)
+#if !defined(MULTI_DRAW)
+layout(location = 4) in mat4 inModel;
+#endif
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
 
 void main()
 {
-    gl_Position = projection * view * model * inPosition;
+#if defined(MULTI_DRAW)
+    mat4 model = GetDrawData().model;
+#elif defined(INSTANCED)
+    mat4 model = inModel;
+#endif
+
+    gl_Position = camera.viewProjection * model * inPosition;
     outColor = inColor;
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+// Written once per camera by GLScene::Render, see GLCameraUniforms.
+layout(std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 position;
+    vec4 viewport;
+    vec4 clusterParams;
+    ivec4 clusterGrid;
+    mat4 inverseViewProjection;
+} camera;
\ No newline at end of file
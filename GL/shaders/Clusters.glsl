@@ -0,0 +1,26 @@
+// Clustered shading, see GLLightClusters. Each cluster lists the indices of the lights
+// reaching it in clusterLightIndices, points first.
+
+#include "Camera.glsl"
+#include "LightData.glsl"
+
+// Matches GLLightClusters::MAX_LIGHTS_PER_CLUSTER.
+#define MAX_CLUSTER_LIGHT_COUNT 128
+
+uniform isamplerBuffer clusterRanges;
+uniform isamplerBuffer clusterLightIndices;
+
+// Offset into clusterLightIndices, point and spot light count of the cluster holding the fragment.
+ivec3 GetCluster(vec3 worldPosition)
+{
+    float depth = -(camera.view * vec4(worldPosition, 1.0)).z;
+    float slice = camera.clusterGrid.w != 0 ? log(max(depth, 1e-4)) * camera.clusterParams.x + camera.clusterParams.y
+                                            : depth * camera.clusterParams.x + camera.clusterParams.y;
+
+    ivec2 tile = ivec2((gl_FragCoord.xy - camera.viewport.xy) / camera.viewport.zw * vec2(camera.clusterGrid.xy));
+    tile = clamp(tile, ivec2(0), camera.clusterGrid.xy - 1);
+
+    int cluster = (clamp(int(slice), 0, camera.clusterGrid.z - 1) * camera.clusterGrid.y + tile.y) * camera.clusterGrid.x + tile.x;
+
+    return texelFetch(clusterRanges, cluster).xyz;
+}
\ No newline at end of file
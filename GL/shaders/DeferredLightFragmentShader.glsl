@@ -0,0 +1,62 @@
+#version 330 core
+
+// Shades the G-buffer written by the GBUFFER material variant, see DeferredLightVertexShader.glsl.
+// The directional pass also restores the depth of the scene for forward rendered objects.
+
+#include "Lighting.glsl"
+#include "Camera.glsl"
+
+uniform sampler2D gAlbedo;
+uniform sampler2D gNormal;
+uniform sampler2D gSpecular;
+uniform sampler2D gDepth;
+
+#if defined(POINT_LIGHT_VOLUME) || defined(SPOT_LIGHT_VOLUME)
+#include "LightData.glsl"
+
+flat in int lightIndex;
+#endif
+
+out vec4 fragColor;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+
+    float depth = texelFetch(gDepth, coord, 0).r;
+
+    // Nothing was drawn here.
+    if (depth == 1.0)
+    {
+        discard;
+    }
+
+    vec4 albedo = texelFetch(gAlbedo, coord, 0);
+    vec4 normalShininess = texelFetch(gNormal, coord, 0);
+    vec3 specular = texelFetch(gSpecular, coord, 0).rgb;
+
+    vec3 norm = normalShininess.xyz;
+    float shininess = normalShininess.w;
+
+    vec2 ndc = (gl_FragCoord.xy - camera.viewport.xy) / camera.viewport.zw * 2.0 - 1.0;
+    vec4 position = camera.inverseViewProjection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+
+    vec3 fragPos = position.xyz / position.w;
+    vec3 viewDir = normalize(camera.position.xyz - fragPos);
+
+#if defined(POINT_LIGHT_VOLUME)
+    fragColor = vec4(ApplyPointLight(FetchPointLight(lightIndex), norm, fragPos, viewDir, albedo.rgb, specular, shininess), 0.0);
+#elif defined(SPOT_LIGHT_VOLUME)
+    fragColor = vec4(ApplySpotLight(FetchSpotLight(lightIndex), norm, fragPos, viewDir, albedo.rgb, specular, shininess), 0.0);
+#else
+    vec3 result = vec3(0.0);
+
+    for(int i = 0; i < lightCounts.x; ++i)
+    {
+        result += ApplyDirectionalLight(directionalLights[i], norm, viewDir, albedo.rgb, specular, shininess);
+    }
+
+    fragColor = vec4(result, albedo.a);
+    gl_FragDepth = depth;
+#endif
+}
\ No newline at end of file
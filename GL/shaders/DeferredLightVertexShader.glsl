@@ -0,0 +1,65 @@
+#version 330 core
+
+// Light passes of deferred shading, see GLDeferredRenderer:
+//   DIRECTIONAL_LIGHTS  a triangle covering the viewport
+//   POINT_LIGHT_VOLUME / SPOT_LIGHT_VOLUME  one sphere per light instance, scaled to the light's range
+
+#include "Lighting.glsl"
+#include "Camera.glsl"
+
+#if defined(POINT_LIGHT_VOLUME) || defined(SPOT_LIGHT_VOLUME)
+#include "LightData.glsl"
+
+layout(location = 0) in vec4 in_Position;
+
+// Matches GLLightBuffer::GetInfluenceThreshold.
+uniform float influenceThreshold;
+// Scale from the unit volume mesh to a mesh enclosing a sphere of radius 1.
+uniform float volumeScale;
+
+flat out int lightIndex;
+
+// Distance at which the light drops below influenceThreshold, as GLLightBuffer::GetRange.
+float GetRange(vec4 position, vec4 ambient, vec4 diffuse)
+{
+    float intensity = max(ambient.x + diffuse.x, max(ambient.y + diffuse.y, ambient.z + diffuse.z));
+
+    float constant = position.w - intensity / influenceThreshold;
+    float linear = ambient.w;
+    float quadratic = diffuse.w;
+
+    if (constant >= 0.0)
+    {
+        return 0.0;
+    }
+
+    if (quadratic > 0.0)
+    {
+        return (-linear + sqrt(linear * linear - 4.0 * quadratic * constant)) / (2.0 * quadratic);
+    }
+
+    return linear > 0.0 ? -constant / linear : 1e6;
+}
+
+void main()
+{
+    lightIndex = gl_InstanceID;
+
+#if defined(POINT_LIGHT_VOLUME)
+    PointLight light = FetchPointLight(lightIndex);
+#else
+    SpotLight light = FetchSpotLight(lightIndex);
+#endif
+
+    float range = GetRange(light.position, light.ambient, light.diffuse);
+
+    gl_Position = camera.viewProjection * vec4(light.position.xyz + in_Position.xyz * range * volumeScale, 1.0);
+}
+#else
+void main()
+{
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
+#endif
\ No newline at end of file
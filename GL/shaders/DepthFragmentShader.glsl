@@ -0,0 +1,7 @@
+#version 330 core
+
+// Only depth is written, color writes are masked during the pre-pass.
+
+void main()
+{
+}
\ No newline at end of file
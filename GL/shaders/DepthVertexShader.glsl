@@ -0,0 +1,34 @@
+#version 330 core
+
+// Depth pre-pass of GLDepthPrePass. The position is computed exactly as in MaterialVertexShader.glsl,
+// so the color pass can test against the pre-pass depth with GL_EQUAL.
+
+#if defined(MULTI_DRAW)
+#include "DrawData.glsl"
+#endif
+
+layout(location = 0) in vec4 in_Position;
+
+#include "Camera.glsl"
+
+#if defined(INSTANCED)
+#if !defined(MULTI_DRAW)
+layout(location = 4) in mat4 in_Model;
+#endif
+#else
+uniform mat4 model;
+#endif
+
+invariant gl_Position;
+
+void main()
+{
+#if defined(MULTI_DRAW)
+    mat4 model = GetDrawData().model;
+#elif defined(INSTANCED)
+    mat4 model = in_Model;
+#endif
+
+    vec4 worldPos = model * in_Position;
+    gl_Position = camera.viewProjection * worldPos;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+// Per draw data of the MULTI_DRAW variants, written by GLRenderQueue, see GLInstanceData.
+// Included before any declaration, the extensions have to come first.
+#extension GL_ARB_shader_draw_parameters : require
+#extension GL_ARB_shader_storage_buffer_object : require
+
+struct DrawData
+{
+    mat4 model;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+layout(std430) readonly buffer Draws
+{
+    DrawData draws[];
+};
+
+// Entry of the first command of the glMultiDrawArraysIndirect call.
+uniform int drawOffset;
+
+DrawData GetDrawData()
+{
+    return draws[drawOffset + gl_DrawIDARB];
+}
\ No newline at end of file
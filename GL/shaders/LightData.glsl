@@ -0,0 +1,31 @@
+// Every active point and spot light, see GLLightBuffer::BindLightData. Needs Lighting.glsl.
+
+uniform samplerBuffer lightData;
+
+PointLight FetchPointLight(int index)
+{
+    int texel = index * 4;
+
+    PointLight light;
+    light.position = texelFetch(lightData, texel);
+    light.ambient = texelFetch(lightData, texel + 1);
+    light.diffuse = texelFetch(lightData, texel + 2);
+    light.specular = texelFetch(lightData, texel + 3);
+
+    return light;
+}
+
+// Spot lights follow the lightCounts.w point lights.
+SpotLight FetchSpotLight(int index)
+{
+    int texel = lightCounts.w * 4 + index * 5;
+
+    SpotLight light;
+    light.position = texelFetch(lightData, texel);
+    light.direction = texelFetch(lightData, texel + 1);
+    light.ambient = texelFetch(lightData, texel + 2);
+    light.diffuse = texelFetch(lightData, texel + 3);
+    light.specular = texelFetch(lightData, texel + 4);
+
+    return light;
+}
\ No newline at end of file
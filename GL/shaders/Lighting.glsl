@@ -0,0 +1,126 @@
+// Matches GLMaterialShader::MAX_LIGHT_COUNT and the GLLightBlock layout.
+#define MAX_LIGHT_COUNT 16
+
+// Scalars are packed into the w components, see GLLightBlock.
+struct DirectionalLight
+{
+    vec4 direction;
+
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+// position.w = constant, ambient.w = linear, diffuse.w = quadratic
+struct PointLight
+{
+    vec4 position;
+
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+// As PointLight, direction.w = cutOff, specular.w = outerCutOff
+struct SpotLight
+{
+    vec4 position;
+    vec4 direction;
+
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+// Packed once per frame by GLScene::Render.
+layout(std140) uniform Lights
+{
+    ivec4 lightCounts;
+
+    DirectionalLight directionalLights[MAX_LIGHT_COUNT];
+    PointLight pointLights[MAX_LIGHT_COUNT];
+    SpotLight spotLights[MAX_LIGHT_COUNT];
+};
+
+vec3 ApplyDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 albedo, vec3 specularColor, float shininess)
+{
+    vec3 lightDir = normalize(-light.direction.xyz);
+    vec3 reflectDir = reflect(-lightDir, normal);
+
+    float normalDotLightDir = dot(normal, lightDir);
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+
+    vec3 ambient = light.ambient.rgb * albedo;
+    vec3 diffuse = light.diffuse.rgb * diff * albedo;
+    vec3 specular = vec3(0.0);
+    if(normalDotLightDir > 0.0)
+    {
+        specular = light.specular.rgb * spec * specularColor;
+    }
+
+    return (ambient + diffuse + specular);
+}
+
+vec3 ApplyPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specularColor, float shininess)
+{
+    vec3 lightDir = normalize(light.position.xyz - fragPos);
+    vec3 halfWayDir = normalize(lightDir + viewDir);
+
+    float normalDotLightDir = dot(normal, lightDir);
+
+    float distance = length(light.position.xyz - fragPos);
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    float spec = pow(clamp(dot(normal, halfWayDir), 0.0, 1.0), shininess);
+
+    float attenuation = 1.0 / (light.position.w + light.ambient.w * distance + light.diffuse.w * (distance * distance));    
+
+    vec3 ambient = light.ambient.rgb * albedo;
+    vec3 diffuse = vec3(0.0);
+    vec3 specular = vec3(0.0);
+    if(normalDotLightDir > 0.0)
+    {
+        diffuse = light.diffuse.rgb * diff * albedo;
+        specular = light.specular.rgb * spec * specularColor;
+    }
+
+    ambient *= attenuation;
+    diffuse *= attenuation;
+    specular *= attenuation;
+
+    return (ambient + diffuse);
+}
+
+vec3 ApplySpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specularColor, float shininess)
+{
+    vec3 lightDir = normalize(light.position.xyz - fragPos);
+    vec3 halfWayDir = normalize(lightDir + viewDir);
+
+    float normalDotLightDir = dot(normal, lightDir);
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    float spec = pow(max(dot(normal, halfWayDir), 0.0), shininess);
+
+    float distance = length(light.position.xyz - fragPos);
+    float attenuation = 1.0 / (light.position.w + light.ambient.w * distance + light.diffuse.w * (distance * distance));    
+
+    float theta = dot(lightDir, normalize(-light.direction.xyz)); 
+    float epsilon = light.direction.w - light.specular.w;
+    float intensity = clamp((theta - light.specular.w) / epsilon, 0.0, 1.0);
+
+    vec3 ambient = light.ambient.rgb * albedo;
+    vec3 diffuse = light.diffuse.rgb * diff * albedo;
+    vec3 specular = vec3(0.0);
+    if(normalDotLightDir > 0.0)
+    {
+        specular = light.specular.rgb * spec * specularColor;
+    }
+
+    ambient *= attenuation * intensity;
+    diffuse *= attenuation * intensity;
+    specular *= attenuation * intensity;
+
+    return (ambient + diffuse + specular);
+}
\ No newline at end of file
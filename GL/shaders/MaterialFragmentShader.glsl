@@ -0,0 +1,167 @@
+#version 330 core
+
+// Variants are selected with defines injected by the engine:
+//   HAS_DIFFUSE_MAP / HAS_DIFFUSE_MAP_ARRAY  diffuse color from a texture or a texture array layer
+//   DIRECTIONAL_LIGHT_COUNT, POINT_LIGHT_COUNT, SPOT_LIGHT_COUNT  fixed light counts,
+//   without them the counts in the Lights block are used.
+//   LIGHT_LIST_SIZE  all directional lights, but only the point and spot lights picked for the object,
+//   at most LIGHT_LIST_SIZE of them, given as indices into the light data buffer.
+//   CLUSTERED_LIGHTING  all directional lights and the point and spot lights of the fragment's cluster.
+//   GBUFFER  no lighting, writes the surface into the G-buffer targets of GLGBuffer instead.
+//   INSTANCED  diffuse color, array layer, specular color and shininess come from the instance.
+//   MULTI_DRAW  with INSTANCED, the instance values are read per draw of a multi-draw call instead.
+
+#include "Lighting.glsl"
+
+struct Material
+{
+#if defined(HAS_DIFFUSE_MAP)
+    sampler2D diffuse;
+#elif defined(HAS_DIFFUSE_MAP_ARRAY)
+    sampler2DArray diffuse;
+    int diffuseLayer;
+#else
+    vec3 ambient;
+    vec3 diffuse;
+#endif
+    vec3 specular;
+    float shininess;
+};
+
+in vec3 fragPosition;
+in vec2 texCoords;
+in vec3 normal;
+in vec3 viewPosition;
+
+uniform Material material;
+
+#if defined(INSTANCED)
+flat in vec4 instanceDiffuse;
+flat in vec4 instanceSpecular;
+
+#define MATERIAL_DIFFUSE instanceDiffuse.rgb
+#define MATERIAL_DIFFUSE_LAYER instanceDiffuse.w
+#define MATERIAL_SPECULAR instanceSpecular.rgb
+#define MATERIAL_SHININESS instanceSpecular.w
+#else
+#define MATERIAL_DIFFUSE material.diffuse
+#define MATERIAL_DIFFUSE_LAYER material.diffuseLayer
+#define MATERIAL_SPECULAR material.specular
+#define MATERIAL_SHININESS material.shininess
+#endif
+
+#if defined(CLUSTERED_LIGHTING) || defined(LIGHT_LIST_SIZE)
+#include "LightData.glsl"
+#endif
+
+#if defined(CLUSTERED_LIGHTING)
+#include "Clusters.glsl"
+
+#undef DIRECTIONAL_LIGHT_COUNT
+#undef POINT_LIGHT_COUNT
+#undef SPOT_LIGHT_COUNT
+#define DIRECTIONAL_LIGHT_COUNT MAX_LIGHT_COUNT
+#define POINT_LIGHT_COUNT MAX_CLUSTER_LIGHT_COUNT
+#define SPOT_LIGHT_COUNT MAX_CLUSTER_LIGHT_COUNT
+#define directionalLightCount lightCounts.x
+#define pointLightCount cluster.y
+#define spotLightCount cluster.z
+#define POINT_LIGHT(i) FetchPointLight(texelFetch(clusterLightIndices, cluster.x + (i)).x)
+#define SPOT_LIGHT(i) FetchSpotLight(texelFetch(clusterLightIndices, cluster.x + cluster.y + (i)).x)
+#elif defined(LIGHT_LIST_SIZE)
+#undef DIRECTIONAL_LIGHT_COUNT
+#undef POINT_LIGHT_COUNT
+#undef SPOT_LIGHT_COUNT
+#define DIRECTIONAL_LIGHT_COUNT MAX_LIGHT_COUNT
+#define POINT_LIGHT_COUNT LIGHT_LIST_SIZE
+#define SPOT_LIGHT_COUNT LIGHT_LIST_SIZE
+#define directionalLightCount lightCounts.x
+#define pointLightCount lightListCounts.x
+#define spotLightCount lightListCounts.y
+#define POINT_LIGHT(i) FetchPointLight(pointLightIndices[i])
+#define SPOT_LIGHT(i) FetchSpotLight(spotLightIndices[i])
+
+uniform ivec2 lightListCounts;
+uniform int pointLightIndices[LIGHT_LIST_SIZE];
+uniform int spotLightIndices[LIGHT_LIST_SIZE];
+#elif defined(DIRECTIONAL_LIGHT_COUNT) && defined(POINT_LIGHT_COUNT) && defined(SPOT_LIGHT_COUNT)
+#define directionalLightCount DIRECTIONAL_LIGHT_COUNT
+#define pointLightCount POINT_LIGHT_COUNT
+#define spotLightCount SPOT_LIGHT_COUNT
+#else
+#undef DIRECTIONAL_LIGHT_COUNT
+#undef POINT_LIGHT_COUNT
+#undef SPOT_LIGHT_COUNT
+#define DIRECTIONAL_LIGHT_COUNT MAX_LIGHT_COUNT
+#define POINT_LIGHT_COUNT MAX_LIGHT_COUNT
+#define SPOT_LIGHT_COUNT MAX_LIGHT_COUNT
+#define directionalLightCount lightCounts.x
+#define pointLightCount lightCounts.y
+#define spotLightCount lightCounts.z
+#endif
+
+#ifndef POINT_LIGHT
+#define POINT_LIGHT(i) pointLights[i]
+#define SPOT_LIGHT(i) spotLights[i]
+#endif
+
+#if defined(GBUFFER)
+layout(location = 0) out vec4 gAlbedo;
+layout(location = 1) out vec4 gNormal;
+layout(location = 2) out vec4 gSpecular;
+#else
+out vec4 fragColor;
+#endif
+
+void main()
+{
+    vec3 norm = normalize(normal);
+    vec3 fragPos = vec3(fragPosition);
+    vec3 viewDir = normalize(viewPosition - fragPos);
+
+#if defined(HAS_DIFFUSE_MAP)
+    vec4 albedo = texture(material.diffuse, texCoords);
+#elif defined(HAS_DIFFUSE_MAP_ARRAY)
+    vec4 albedo = texture(material.diffuse, vec3(texCoords, MATERIAL_DIFFUSE_LAYER));
+#else
+    vec4 albedo = vec4(MATERIAL_DIFFUSE, 1.0);
+#endif
+
+    vec3 specular = MATERIAL_SPECULAR;
+    float shininess = MATERIAL_SHININESS;
+
+#if defined(GBUFFER)
+    gAlbedo = albedo;
+    gNormal = vec4(norm, shininess);
+    gSpecular = vec4(specular, 1.0);
+#else
+    vec3 result = vec3(0.0);
+
+#if defined(CLUSTERED_LIGHTING)
+    ivec3 cluster = GetCluster(fragPos);
+#endif
+
+#if DIRECTIONAL_LIGHT_COUNT > 0
+    for(int i = 0; i < directionalLightCount; ++i)
+    {
+        result += ApplyDirectionalLight(directionalLights[i], norm, viewDir, albedo.rgb, specular, shininess);
+    }
+#endif
+
+#if POINT_LIGHT_COUNT > 0
+    for(int i = 0; i < pointLightCount; ++i)
+    {
+        result += ApplyPointLight(POINT_LIGHT(i), norm, fragPos, viewDir, albedo.rgb, specular, shininess);
+    }
+#endif
+
+#if SPOT_LIGHT_COUNT > 0
+    for(int i = 0; i < spotLightCount; ++i)
+    {
+        result += ApplySpotLight(SPOT_LIGHT(i), norm, fragPos, viewDir, albedo.rgb, specular, shininess);
+    }
+#endif
+
+    fragColor = vec4(result, albedo.a);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#version 330 core
+
+#if defined(MULTI_DRAW)
+#include "DrawData.glsl"
+#endif
+
+layout(location = 0) in vec4 in_Position;
+layout(location = 1) in vec4 in_Color;
+layout(location = 2) in vec4 in_Normal;
+layout(location = 3) in vec2 in_UV;
+
+out vec3 fragPosition;
+out vec2 texCoords;
+out vec3 normal;
+out vec3 viewPosition;
+
+#include "Camera.glsl"
+
+// INSTANCED reads the model matrix and material colors per instance, see GLInstanceBuffer.
+// MULTI_DRAW, always set together with INSTANCED, reads them per draw from DrawData.glsl.
+#if defined(INSTANCED)
+#if !defined(MULTI_DRAW)
+layout(location = 4) in mat4 in_Model;
+layout(location = 8) in vec4 in_Diffuse;
+layout(location = 9) in vec4 in_Specular;
+#endif
+
+flat out vec4 instanceDiffuse;
+flat out vec4 instanceSpecular;
+#else
+uniform mat4 model;
+#endif
+
+// Matches DepthVertexShader.glsl, the depth pre-pass relies on identical depth values.
+invariant gl_Position;
+
+void main()
+{
+#if defined(MULTI_DRAW)
+    DrawData draw = GetDrawData();
+    mat4 model = draw.model;
+
+    instanceDiffuse = draw.diffuse;
+    instanceSpecular = draw.specular;
+#elif defined(INSTANCED)
+    mat4 model = in_Model;
+
+    instanceDiffuse = in_Diffuse;
+    instanceSpecular = in_Specular;
+#endif
+
+    vec4 worldPos = model * in_Position;
+    gl_Position = camera.viewProjection * worldPos;
+
+    fragPosition = worldPos.xyz;
+
+    texCoords = in_UV;
+
+    normal = mat3(transpose(inverse(model))) * vec3(in_Normal);
+
+    viewPosition = camera.position.xyz;
+}
\ No newline at end of file
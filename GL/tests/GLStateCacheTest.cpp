@@ -0,0 +1,205 @@
+#include <iostream>
+#include <vector>
+
+#include "GLStateCache.h"
+#include "GLRenderQueue.h"
+#include "GLPrimitiveMeshes.h"
+
+static int failures = 0;
+
+#define GL_CHECK_EQUAL(actual, expected) CheckEqual(#actual, (size_t)(actual), (size_t)(expected), __LINE__)
+
+static void CheckEqual(const char* name, size_t actual, size_t expected, int line)
+{
+	if (actual != expected)
+	{
+		std::cout << "GLStateCacheTest(" << line << "): " << name << " is " << actual << ", expected " << expected << std::endl;
+		failures++;
+	}
+}
+
+static void Reset()
+{
+	GLStubBackend::ResetCalls();
+	GLStateCache::ResetStats();
+}
+
+// Repeated requests reach GL once, the rest are counted as skipped.
+static void TestRedundantState()
+{
+	GLStateCache::SetEnabled(GL_BLEND, false);
+	GLStateCache::SetEnabled(GL_CULL_FACE, false);
+	GLStateCache::UseProgram(0);
+	GLStateCache::BindVertexArray(0);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, 0);
+	GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	Reset();
+
+	GLStateCache::SetEnabled(GL_BLEND, true);
+	GLStateCache::SetEnabled(GL_BLEND, true);
+	GLStateCache::SetEnabled(GL_BLEND, false);
+	GLStateCache::SetEnabled(GL_BLEND, false);
+	GLStateCache::SetEnabled(GL_CULL_FACE, true);
+	GLStateCache::SetEnabled(GL_CULL_FACE, true);
+
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().Enable, 2);
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().Disable, 1);
+	GL_CHECK_EQUAL(GLStateCache::GetStats().Skipped, 3);
+
+	GLStateCache::UseProgram(7);
+	GLStateCache::UseProgram(7);
+	GLStateCache::UseProgram(7);
+	GLStateCache::UseProgram(8);
+
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().UseProgram, 2);
+	GL_CHECK_EQUAL(GLStateCache::GetStats().Skipped, 5);
+
+	GLStateCache::BindVertexArray(3);
+	GLStateCache::BindVertexArray(3);
+	GLStateCache::BindVertexArray(0);
+
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().BindVertexArray, 2);
+	GL_CHECK_EQUAL(GLStateCache::GetStats().Skipped, 6);
+
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, 4);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, 4);
+	GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, 4);
+
+	// Element array bindings belong to the vertex array, so they are always passed on.
+	GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 5);
+	GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 5);
+
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().BindBuffer, 4);
+	GL_CHECK_EQUAL(GLStateCache::GetStats().Skipped, 7);
+	GL_CHECK_EQUAL(GLStateCache::GetStats().Changes, 11);
+
+	// Tracked capabilities are answered from the cache.
+	GLStateCache::IsEnabled(GL_BLEND);
+	GLStateCache::IsEnabled(GL_CULL_FACE);
+	GLStateCache::IsEnabled(GL_DEPTH_TEST);
+
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().IsEnabled, 0);
+}
+
+// After Invalidate the next request always reaches GL, and a capability is queried at most once.
+static void TestInvalidate()
+{
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+	GLStateCache::UseProgram(7);
+
+	GLStateCache::Invalidate();
+	Reset();
+
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+	GLStateCache::UseProgram(7);
+
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().Enable, 1);
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().UseProgram, 1);
+	GL_CHECK_EQUAL(GLStateCache::GetStats().Skipped, 0);
+
+	GLStateCache::IsEnabled(GL_BLEND);
+	GLStateCache::IsEnabled(GL_BLEND);
+
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().IsEnabled, 1);
+}
+
+// A frame of one instanced run of cubes and three single spheres, drawn with the instanced
+// and the plain variant of the material program.
+static void TestRenderQueueSubmit()
+{
+	GLShaderBinaryCache::SetEnabled(false);
+	GLShaderRegistry::SetAsync(false);
+
+	// Light list draws are not instanced.
+	GLMeshRenderer::SetLightListSize(0);
+
+	GLLightBuffer lights;
+
+	std::vector<GLSharedPtr<GLMeshRenderer>> renderers;
+	std::vector<glm::mat4> models;
+
+	for (int i = 0; i < 9; ++i)
+	{
+		auto renderer = GLCreate<GLMeshRenderer>();
+
+		if (i < 6)
+		{
+			renderer->SetMesh(GLGetSharedPrimitiveMesh<GLCubeMesh>(GLColor(1.0f, 1.0f, 1.0f)));
+		}
+		else
+		{
+			renderer->SetMesh(GLCreate<GLUVSphereMesh>(8u + i, 6u, GLColor(1.0f, 1.0f, 1.0f)));
+		}
+
+		renderer->GetMaterial()->SetDiffuse(glm::vec3(i / 9.0f, 0.5f, 0.5f));
+
+		renderers.push_back(renderer);
+		models.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(i - 4.0f, 0.0f, -10.0f)));
+	}
+
+	glm::mat4 viewMatrix(1.0f);
+	glm::mat4 projectionMatrix(1.0f);
+
+	GLRenderCommandBuffer commands;
+	commands.Begin(viewMatrix, nullptr, lights);
+
+	for (size_t i = 0; i < renderers.size(); ++i)
+	{
+		commands.Add(renderers[i], models[i]);
+	}
+
+	commands.End();
+
+	GLRenderQueue queue;
+	queue.Begin(viewMatrix, projectionMatrix, lights);
+	queue.Add(commands);
+	queue.Sort();
+
+	Reset();
+
+	// The first frame also uploads the meshes, yet binds each program once and queries nothing.
+	queue.Submit();
+
+	GL_CHECK_EQUAL(queue.GetStats().Draws, 4);
+	GL_CHECK_EQUAL(queue.GetStats().InstancedItems, 6);
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().Draws, 4);
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().UseProgram, 2);
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().IsEnabled, 0);
+
+	// Uploads bound the mesh buffers, the next frame binds the instance buffer again.
+	queue.Submit();
+
+	Reset();
+
+	queue.Submit();
+
+	// Every draw requests its program, blend, culling and vertex array, the instanced draw its
+	// instance buffer and the submit restores the depth mask, 18 requests. Only the switches
+	// between the two programs and the four vertex arrays reach GL.
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().Draws, 4);
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().Enable, 0);
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().Disable, 0);
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().IsEnabled, 0);
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().UseProgram, 2);
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().BindVertexArray, 4);
+	GL_CHECK_EQUAL(GLStubBackend::GetCalls().BindBuffer, 0);
+	GL_CHECK_EQUAL(GLStateCache::GetStats().Changes, 6);
+	GL_CHECK_EQUAL(GLStateCache::GetStats().Skipped, 12);
+}
+
+int main()
+{
+	TestRenderQueueSubmit();
+	TestRedundantState();
+	TestInvalidate();
+
+	if (failures > 0)
+	{
+		std::cout << "GLStateCacheTest: " << failures << " checks failed" << std::endl;
+		return 1;
+	}
+
+	std::cout << "GLStateCacheTest: passed" << std::endl;
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include <cstring>
+
+#include <gl/glew.h>
+
+static GLStubCalls calls;
+
+// Names of every kind of object come from one counter, 0 stays the default object.
+static GLuint nextName = 1;
+
+static void GenNames(GLsizei count, GLuint* names)
+{
+	for (GLsizei i = 0; i < count; ++i)
+	{
+		names[i] = nextName++;
+	}
+}
+
+const GLStubCalls& GLStubBackend::GetCalls()
+{
+	return calls;
+}
+
+void GLStubBackend::ResetCalls()
+{
+	calls = GLStubCalls();
+}
+
+GLboolean glewExperimental = GL_FALSE;
+
+GLenum glewInit()
+{
+	return GLEW_OK;
+}
+
+GLboolean GLEW_VERSION_4_1 = GL_FALSE;
+
+GLboolean GLEW_ARB_get_program_binary = GL_FALSE;
+GLboolean GLEW_ARB_multi_draw_indirect = GL_FALSE;
+GLboolean GLEW_ARB_parallel_shader_compile = GL_FALSE;
+GLboolean GLEW_ARB_shader_draw_parameters = GL_FALSE;
+GLboolean GLEW_ARB_shader_storage_buffer_object = GL_FALSE;
+GLboolean GLEW_EXT_texture_filter_anisotropic = GL_FALSE;
+GLboolean GLEW_KHR_parallel_shader_compile = GL_FALSE;
+
+// Counted state.
+
+void APIENTRY glEnable(GLenum)
+{
+	calls.Enable++;
+}
+
+void APIENTRY glDisable(GLenum)
+{
+	calls.Disable++;
+}
+
+GLboolean APIENTRY glIsEnabled(GLenum)
+{
+	calls.IsEnabled++;
+	return GL_FALSE;
+}
+
+void APIENTRY glUseProgram(GLuint)
+{
+	calls.UseProgram++;
+}
+
+void APIENTRY glBindVertexArray(GLuint)
+{
+	calls.BindVertexArray++;
+}
+
+void APIENTRY glBindBuffer(GLenum, GLuint)
+{
+	calls.BindBuffer++;
+}
+
+void APIENTRY glDrawArrays(GLenum, GLint, GLsizei)
+{
+	calls.Draws++;
+}
+
+void APIENTRY glDrawArraysInstanced(GLenum, GLint, GLsizei, GLsizei)
+{
+	calls.Draws++;
+}
+
+void APIENTRY glMultiDrawArraysIndirect(GLenum, const void*, GLsizei, GLsizei)
+{
+	calls.Draws++;
+}
+
+// Other state.
+
+void APIENTRY glBlendFunc(GLenum, GLenum) { }
+void APIENTRY glCullFace(GLenum) { }
+void APIENTRY glDepthFunc(GLenum) { }
+void APIENTRY glDepthMask(GLboolean) { }
+void APIENTRY glColorMask(GLboolean, GLboolean, GLboolean, GLboolean) { }
+void APIENTRY glViewport(GLint, GLint, GLsizei, GLsizei) { }
+void APIENTRY glPixelStorei(GLenum, GLint) { }
+void APIENTRY glBindFramebuffer(GLenum, GLuint) { }
+void APIENTRY glBindBufferBase(GLenum, GLuint, GLuint) { }
+void APIENTRY glActiveTexture(GLenum) { }
+void APIENTRY glBindTexture(GLenum, GLuint) { }
+void APIENTRY glBindSampler(GLuint, GLuint) { }
+
+// Objects.
+
+void APIENTRY glGenBuffers(GLsizei count, GLuint* names) { GenNames(count, names); }
+void APIENTRY glGenVertexArrays(GLsizei count, GLuint* names) { GenNames(count, names); }
+void APIENTRY glGenTextures(GLsizei count, GLuint* names) { GenNames(count, names); }
+void APIENTRY glGenSamplers(GLsizei count, GLuint* names) { GenNames(count, names); }
+
+void APIENTRY glDeleteBuffers(GLsizei, const GLuint*) { }
+void APIENTRY glDeleteVertexArrays(GLsizei, const GLuint*) { }
+void APIENTRY glDeleteTextures(GLsizei, const GLuint*) { }
+void APIENTRY glDeleteSamplers(GLsizei, const GLuint*) { }
+
+void APIENTRY glBufferData(GLenum, GLsizeiptr, const void*, GLenum) { }
+void APIENTRY glBufferSubData(GLenum, GLintptr, GLsizeiptr, const void*) { }
+void APIENTRY glCopyBufferSubData(GLenum, GLenum, GLintptr, GLintptr, GLsizeiptr) { }
+
+void APIENTRY glVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) { }
+void APIENTRY glVertexAttribDivisor(GLuint, GLuint) { }
+void APIENTRY glEnableVertexAttribArray(GLuint) { }
+
+void APIENTRY glTexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*) { }
+void APIENTRY glTexParameteri(GLenum, GLenum, GLint) { }
+void APIENTRY glTexBuffer(GLenum, GLenum, GLuint) { }
+void APIENTRY glGenerateMipmap(GLenum) { }
+
+void APIENTRY glSamplerParameteri(GLuint, GLenum, GLint) { }
+void APIENTRY glSamplerParameterf(GLuint, GLenum, GLfloat) { }
+
+// Programs, every compile and link succeeds and nothing is reflected.
+
+GLuint APIENTRY glCreateShader(GLenum)
+{
+	return nextName++;
+}
+
+GLuint APIENTRY glCreateProgram()
+{
+	return nextName++;
+}
+
+void APIENTRY glDeleteShader(GLuint) { }
+void APIENTRY glDeleteProgram(GLuint) { }
+
+void APIENTRY glShaderSource(GLuint, GLsizei, const GLchar* const*, const GLint*) { }
+void APIENTRY glCompileShader(GLuint) { }
+void APIENTRY glAttachShader(GLuint, GLuint) { }
+void APIENTRY glLinkProgram(GLuint) { }
+void APIENTRY glProgramParameteri(GLuint, GLenum, GLint) { }
+void APIENTRY glProgramBinary(GLuint, GLenum, const void*, GLsizei) { }
+void APIENTRY glMaxShaderCompilerThreadsARB(GLuint) { }
+void APIENTRY glMaxShaderCompilerThreadsKHR(GLuint) { }
+
+void APIENTRY glGetShaderiv(GLuint, GLenum name, GLint* value)
+{
+	*value = name == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+void APIENTRY glGetProgramiv(GLuint, GLenum name, GLint* value)
+{
+	*value = name == GL_LINK_STATUS || name == GL_COMPLETION_STATUS_KHR ? GL_TRUE : 0;
+}
+
+void APIENTRY glGetShaderInfoLog(GLuint, GLsizei size, GLsizei* length, GLchar* log)
+{
+	if (length != NULL)
+	{
+		*length = 0;
+	}
+
+	if (size > 0)
+	{
+		log[0] = '\0';
+	}
+}
+
+void APIENTRY glGetProgramInfoLog(GLuint program, GLsizei size, GLsizei* length, GLchar* log)
+{
+	glGetShaderInfoLog(program, size, length, log);
+}
+
+void APIENTRY glGetProgramBinary(GLuint, GLsizei, GLsizei* length, GLenum*, void*)
+{
+	*length = 0;
+}
+
+void APIENTRY glGetActiveUniform(GLuint, GLuint, GLsizei, GLsizei*, GLint*, GLenum*, GLchar*) { }
+void APIENTRY glGetActiveUniformsiv(GLuint, GLsizei, const GLuint*, GLenum, GLint*) { }
+void APIENTRY glGetActiveUniformBlockiv(GLuint, GLuint, GLenum, GLint*) { }
+void APIENTRY glGetActiveUniformBlockName(GLuint, GLuint, GLsizei, GLsizei*, GLchar*) { }
+void APIENTRY glUniformBlockBinding(GLuint, GLuint, GLuint) { }
+void APIENTRY glShaderStorageBlockBinding(GLuint, GLuint, GLuint) { }
+
+GLint APIENTRY glGetUniformLocation(GLuint, const GLchar*)
+{
+	return -1;
+}
+
+GLuint APIENTRY glGetProgramResourceIndex(GLuint, GLenum, const GLchar*)
+{
+	return GL_INVALID_INDEX;
+}
+
+void APIENTRY glUniform1i(GLint, GLint) { }
+void APIENTRY glUniform2i(GLint, GLint, GLint) { }
+void APIENTRY glUniform1f(GLint, GLfloat) { }
+void APIENTRY glUniform3f(GLint, GLfloat, GLfloat, GLfloat) { }
+void APIENTRY glUniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat*) { }
+
+// Queries.
+
+void APIENTRY glGetBooleanv(GLenum, GLboolean* value)
+{
+	*value = GL_FALSE;
+}
+
+void APIENTRY glGetIntegerv(GLenum, GLint* value)
+{
+	*value = 0;
+}
+
+void APIENTRY glGetFloatv(GLenum, GLfloat* value)
+{
+	*value = 0.0f;
+}
+
+const GLubyte* APIENTRY glGetString(GLenum)
+{
+	return (const GLubyte*)"";
+}
\ No newline at end of file
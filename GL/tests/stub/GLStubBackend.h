@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// Calls of the state the GLStateCache shadows, made since the last ResetCalls.
+struct GLStubCalls
+{
+	size_t Enable = 0;
+	size_t Disable = 0;
+	size_t IsEnabled = 0;
+
+	size_t UseProgram = 0;
+	size_t BindVertexArray = 0;
+	size_t BindBuffer = 0;
+
+	size_t Draws = 0;
+};
+
+// GL without a driver. Object names are handed out in order, compiles and links succeed, queries
+// return zeroes and nothing is drawn, only the calls are counted.
+class GLStubBackend
+{
+public:
+	static const GLStubCalls& GetCalls();
+
+	static void ResetCalls();
+};
\ No newline at end of file
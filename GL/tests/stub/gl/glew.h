@@ -0,0 +1,31 @@
+#pragma once
+
+// Stands in for GLEW when the engine is built against GLStubBackend. The GL API comes from the
+// Khronos headers, every function is defined by the stub backend instead of a driver, so the
+// tests run without a context. Extensions are reported as missing.
+
+#define GL_GLEXT_PROTOTYPES 1
+
+// The engine headers get assert from the platform headers of a real build.
+#include <cassert>
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#define GLEW_OK 0
+
+extern GLboolean glewExperimental;
+
+GLenum glewInit();
+
+extern GLboolean GLEW_VERSION_4_1;
+
+extern GLboolean GLEW_ARB_get_program_binary;
+extern GLboolean GLEW_ARB_multi_draw_indirect;
+extern GLboolean GLEW_ARB_parallel_shader_compile;
+extern GLboolean GLEW_ARB_shader_draw_parameters;
+extern GLboolean GLEW_ARB_shader_storage_buffer_object;
+extern GLboolean GLEW_EXT_texture_filter_anisotropic;
+extern GLboolean GLEW_KHR_parallel_shader_compile;
+
+#include "../GLStubBackend.h"
\ No newline at end of file